@@ -1,7 +1,10 @@
+#ifndef ACC_ROT_INSTRUCTIONS_H
+#define ACC_ROT_INSTRUCTIONS_H
+
 #include "instructions.h" 
 
 //Shifts bits right, replaces msb with lsb. Value from accumulator
-int rrca(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rrca(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getRegisterValue8(cpu, REG_A);
     int bit0 = val & 0x1; //Left with the least significant bit, which gets shifted out
@@ -20,7 +23,7 @@ int rrca(CPU* cpu, Instruction* instruction) {
 }
 
 //Shifts bits right, reaplaces msb with carry bit
-int rra(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rra(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getRegisterValue8(cpu, REG_A);
     int carry = flagIsSet(cpu, CARRY);
@@ -39,7 +42,7 @@ int rra(CPU* cpu, Instruction* instruction) {
 }
 
 //Shifts bit left, replaces lsb with previos msb
-int rlca(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rlca(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getRegisterValue8(cpu, REG_A);
     int bit7 = val & (1 << 7);
@@ -58,7 +61,7 @@ int rlca(CPU* cpu, Instruction* instruction) {
 }
 
 //Shifts bits left, replaces lsb with carry bit
-int rla(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rla(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getRegisterValue8(cpu, REG_A);
     int bit7 = val & (1 << 7);
@@ -75,4 +78,6 @@ int rla(CPU* cpu, Instruction* instruction) {
 
     //0 extra t-cycles
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
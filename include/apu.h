@@ -5,6 +5,30 @@
 #include "memory_bus.h"
 #include "sdl_data.h"
 #include "apu_state.h"
+#include "scheduler.h"
+
+//DIV-APU goes up whenever DIV bit 4 (bit 12 of the system time) goes from 1 to 0, so every this many ticks
+//unless DIV gets written. This would be bit 5 in CGB double speed mode
+#define APU_DIV_SYSTEM_BIT 12
+#define APU_DIV_PERIOD (1 << (APU_DIV_SYSTEM_BIT + 1))
+
+/*
+* Catch-up APU.
+* The APU doesn't get ticked with the rest of the hardware either. It only runs (apu_catch_up) when something could
+* hear or see what it's doing: the CPU touching the sound registers or wave RAM (0xFF10-0xFF3F), a sample going into
+* the audio buffer (EVENT_APU_SAMPLE) or DIV-APU going up (EVENT_APU_FRAME_SEQUENCER).
+* Only triggers, turning the APU off and DIV-APU ticks change anything other than the period dividers and the LFSR,
+* so those ticks get done one at a time and everything in between gets skipped over in one go.
+*/
+
+#define LFSR_JUMP_POWERS 64 //Jumps for 1, 2, 4... clocks, enough for any count that fits in 64 bits
+
+//Clocking the LFSR only ever XORs bits together (XNOR is just XOR with 1), so any number of clocks in a row
+//works out to a fixed set of output bits to flip for each input bit, plus a constant
+typedef struct {
+	uint16_t bits[16]; //Output bits each input bit flips
+	uint16_t constant; //Output when the LFSR is 0
+} LFSRJump;
 
 //Struct for getting audio samples. Contains left and right output
 typedef struct {
@@ -126,10 +150,10 @@ typedef struct {
 
 //Local state variables for APU
 typedef struct {
-	uint8_t div_bit; //Which bit of DIV to check. On DMG this is always 4, but depending on double speed mode this can be bit 5
-	uint8_t prev_div_state; //Previous DIV bit to detect updates for incrementing APU DIV
+	uint64_t apu_div_time; //Tick APU div last went up on. It's an event on the scheduler, so nothing checks DIV every tick
 	uint8_t apu_div; //APU div is connected to div and ticks up at 256Hz given no writes to DIV
 	uint8_t apu_div_updated; //Flag for whether or not an update occured and certain things need to be checked
+	uint64_t synced_time; //APU has done every tick before this one (see apu_catch_up)
 
 	//Individual channel state
 	Ch1State ch1;
@@ -142,7 +166,7 @@ typedef struct {
 	double error_accumulator; //This will accumulate error from the sample timing
 } LocalAPUState;
 
-typedef struct {
+typedef struct APU {
 	//Memory bus pointer
 	MemoryBus* bus;
 
@@ -152,6 +176,9 @@ typedef struct {
 	//APU Duty cycles
 	uint8_t duty_cycles[32]; //4 options with 8 samples each. This determines how much of a pulse wave is high vs low
 
+	//LFSR jumps for 2^n clocks in 15 bit and 7 bit mode, so skipped ticks don't clock it one at a time
+	LFSRJump lfsr_jumps[2][LFSR_JUMP_POWERS];
+
 	//Local state
 	LocalAPUState local_state;
 
@@ -159,16 +186,18 @@ typedef struct {
 	GlobalAPUState* global_state;
 } APU;
 
-//APU initialization and destruction
-APU* apu_init(MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_data);
-void apu_destroy(APU* apu);
+//APU initialization
+APU* apu_init(APU* apu, MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_data);
 
 void fill_buffer(APU* apu);
 APUSample mix_dac_values(APU* apu); //Gets the mixed DAC value to add to audio buffer
 
-void update_apu(APU* apu, uint64_t emulator_time);
+void update_apu(APU* apu, uint64_t emulator_time); //Does one whole tick
+void apu_catch_up(APU* apu, uint64_t time); //Does every tick before time
+void apu_sample_event(APU* apu, uint64_t time); //Next sample goes into the audio buffer
 void update_dacs(APU* apu);
-void update_div_apu(APU* apu);
+void apu_div_event(APU* apu, uint64_t time); //DIV bit 4 just went from 1 to 0
+void apu_div_reset(Scheduler* scheduler, uint64_t now, uint16_t system_time); //DIV got written, system_time is what it was going to be
 void update_channel_active(APU* apu, uint64_t emulator_time);
 
 void turn_off_apu(APU* apu);
@@ -184,5 +213,7 @@ void update_ch3(APU* apu, uint64_t emulator_time);
 void update_ch4(APU* apu, uint64_t emulator_time);
 
 void clock_lsfr(APU* apu);
+uint16_t lfsr_step(uint16_t lfsr, uint8_t mode); //One LFSR clock. Mode is bit 3 of NR43
+uint16_t lfsr_jump(APU* apu, uint16_t lfsr, uint8_t mode, uint64_t clocks); //Same as clocking it that many times
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
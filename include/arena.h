@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+* Arena allocator.
+* One zeroed block that gets split up in order and freed all at once. The whole emulated machine lives in one:
+* the Memory struct, the MBC, every memory region, then CoreState (CPU, bus, PPU, APU and their states) and the
+* block cache, all at fixed offsets instead of a dozen separate mallocs spread around the heap.
+* Pointers between them are plain pointers, so a copy of the used part can only be copied back into the same
+* arena, but that makes it a full snapshot of the machine (see system_save_snapshot).
+*/
+
+#define ARENA_ALIGNMENT 16 //Default alignment for anything allocated from an arena
+
+typedef struct {
+    uint8_t* base;
+    size_t size;
+    size_t used;
+} Arena;
+
+//Space to reserve for an allocation, including the worst case for lining it up
+#define ARENA_SPACE(size, alignment) ((size) + (alignment) - 1)
+
+uint8_t arena_init(Arena* arena, size_t size); //Returns 0 for success, 1 for failure
+void* arena_alloc(Arena* arena, size_t size, size_t alignment); //Returns NULL if there isn't enough room left
+void arena_destroy(Arena* arena);
+
+#endif
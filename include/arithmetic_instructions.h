@@ -1,8 +1,11 @@
+#ifndef ARITHMETIC_INSTRUCTIONS_H
+#define ARITHMETIC_INSTRUCTIONS_H
+
 #include "cpu.h"
 #include "instructions.h"
 
 //Adds values from 2 8-bit regsiters and stores it into the first one
-int add_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int add_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t dest_val = getRegisterValue8(cpu, instruction->first_operand);
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
@@ -13,17 +16,14 @@ int add_r8_r8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Check flags
-    clearFlag(cpu, SUB); //Subtraction flag
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD(dest_val, src_val));
+    setAddFlags(cpu, dest_val, src_val, 0, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Adds value from 8-bit register to value at address stored in 16-bit register and stores it in the 8-bit register
-int add_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int add_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t dest_val = getRegisterValue8(cpu, instruction->first_operand);
@@ -35,19 +35,16 @@ int add_r8_r16mem(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Update flags
-    clearFlag(cpu, SUB); //Subtraction flag
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result)); //Zero flag
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result)); //Carry flag
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD(src_val, dest_val));
+    setAddFlags(cpu, dest_val, src_val, 0, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Add value in 8-bit regsiter to 8-bit immediate and store it in the 8-bit regsiter
-int add_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int add_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t src_val = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_val = fetchByte(cpu);
     uint8_t dest_val = getRegisterValue8(cpu, instruction->first_operand);
     
     uint16_t result = src_val + dest_val;
@@ -56,17 +53,14 @@ int add_r8_imm8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Update flags
-    clearFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD(src_val, dest_val));
+    setAddFlags(cpu, dest_val, src_val, 0, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Add values of 2 16-bit registers and stores it in the first one
-int add_r16_r16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int add_r16_r16(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_val = getRegisterValue16(cpu, instruction->second_operand);
     uint16_t dest_val = getRegisterValue16(cpu, instruction->first_operand);
@@ -86,9 +80,9 @@ int add_r16_r16(CPU* cpu, Instruction* instruction) {
 }
 
 //Adds value stored in 16-bit register to signed 8-bit immediate and stores it in 16-bit register
-int add_r16_imm8s(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int add_r16_imm8s(CPU* cpu, Instruction* instruction) {
     //Get values
-    int8_t src_val = (int8_t)mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    int8_t src_val = (int8_t)fetchByte(cpu);
     uint16_t dest_val = getRegisterValue16(cpu, instruction->first_operand);
 
     uint16_t result = dest_val + src_val;
@@ -108,7 +102,7 @@ int add_r16_imm8s(CPU* cpu, Instruction* instruction) {
 }
 
 //Adds value in 8-bit register to 8-bit register as well as the carry bit and stores in first 8-bit register
-int adc_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int adc_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t dest_val = getRegisterValue8(cpu, instruction->first_operand);
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
@@ -120,17 +114,14 @@ int adc_r8_r8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Update flags
-    clearFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD_W_CARRY(src_val, dest_val, carry));
+    setAddFlags(cpu, dest_val, src_val, carry, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Add value from 8-bit register to carry bit and value from address stored at 16-bit register, then store the result in 8-bit register
-int adc_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int adc_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t src_val = mem_read(cpu->bus, src_address, CPU_ACCESS);
@@ -143,19 +134,16 @@ int adc_r8_r16mem(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Update flags
-    clearFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD_W_CARRY(src_val, dest_val, carry));
+    setAddFlags(cpu, dest_val, src_val, carry, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Adds value in 8 bit register to immediate 8 bit value and carry and stores value in 8-bit register
-int adc_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int adc_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t src_val = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_val = fetchByte(cpu);
     uint8_t dest_val = getRegisterValue8(cpu, instruction->first_operand);
     int carry = flagIsSet(cpu, CARRY);
 
@@ -165,17 +153,14 @@ int adc_r8_imm8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, (uint8_t)result);
 
     //Update flags
-    clearFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_ADD(result));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_ADD_W_CARRY(src_val, dest_val, carry));
+    setAddFlags(cpu, dest_val, src_val, carry, result);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts value in 2nd 8-bit register from value in 1st 8-bit register and stores the result in the first 8-bit register
-int sub_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sub_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
     uint8_t secondOp = getRegisterValue8(cpu, instruction->second_operand);
@@ -186,17 +171,14 @@ int sub_r8_r8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOp, secondOp));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOp, secondOp));
+    setSubFlags(cpu, firstOp, secondOp, 0);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts value at address stored in 16-bit register from 8-bit register value, then stores result in 8-bit register
-int sub_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sub_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t secondOp = mem_read(cpu->bus, src_address, CPU_ACCESS);
@@ -208,20 +190,17 @@ int sub_r8_r16mem(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOp, secondOp));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOp, secondOp));
+    setSubFlags(cpu, firstOp, secondOp, 0);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts 8-bit immediate from value in 8-bit regsiter and stores the result in 8-bit register
-int sub_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sub_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOperand = getRegisterValue8(cpu, instruction->first_operand);
-    uint8_t secondOperand = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t secondOperand = fetchByte(cpu);
 
     uint8_t result = firstOperand - secondOperand;
 
@@ -229,17 +208,14 @@ int sub_r8_imm8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOperand, secondOperand));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOperand, secondOperand));
+    setSubFlags(cpu, firstOperand, secondOperand, 0);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtraction from 8-bit register with carry
-int sbc_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sbc_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
     uint8_t secondOp = getRegisterValue8(cpu, instruction->second_operand);
@@ -251,17 +227,14 @@ int sbc_r8_r8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
+    setSubFlags(cpu, firstOp, secondOp, carry);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts 8-bit value at address stored in 16-bit register with carry then stores the result back
-int sbc_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sbc_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
@@ -274,20 +247,17 @@ int sbc_r8_r16mem(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
+    setSubFlags(cpu, firstOp, secondOp, carry);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts 8-bit immediate from value in 8-bit register then stores the result in register
-int sbc_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sbc_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
-    uint8_t secondOp = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t secondOp = fetchByte(cpu);
     int carry = flagIsSet(cpu, CARRY);
 
     uint8_t result = firstOp - secondOp - carry;
@@ -296,60 +266,50 @@ int sbc_r8_imm8(CPU* cpu, Instruction* instruction) {
     setRegisterValue(cpu, instruction->first_operand, result);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(result));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB_W_CARRY(firstOp, secondOp, carry));
+    setSubFlags(cpu, firstOp, secondOp, carry);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts 8-bit register value from 8-bit register value and updates flags
-int cp_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int cp_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
     uint8_t secondOp = getRegisterValue8(cpu, instruction->second_operand);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(firstOp - secondOp));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOp, secondOp));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOp, secondOp));
+    setSubFlags(cpu, firstOp, secondOp, 0);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts value at address stored in 16-bit regstier from 8-bit register and updates flags
-int cp_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int cp_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t secondOp = mem_read(cpu->bus, src_address, CPU_ACCESS);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(firstOp - secondOp));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOp, secondOp));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOp, secondOp));
+    setSubFlags(cpu, firstOp, secondOp, 0);
 
     //0 extra t-cycles
     return 0;
 }
 
 //Subtracts 8-bit immediate from value stored in 8-bit register and updates flags
-int cp_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int cp_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t firstOp = getRegisterValue8(cpu, instruction->first_operand);
-    uint8_t secondOp = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t secondOp = fetchByte(cpu);
 
     //Update flags
-    setFlag(cpu, SUB);
-    updateFlag(cpu, ZERO, CHECK_ZERO_8(firstOp - secondOp));
-    updateFlag(cpu, CARRY, CHECK_CARRY_8BIT_SUB(firstOp, secondOp));
-    updateFlag(cpu, HALFCARRY, CHECK_HALF_CARRY_8BIT_SUB(firstOp, secondOp));
+    setSubFlags(cpu, firstOp, secondOp, 0);
 
     //0 extra t-cycles
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <stdint.h>
+
+#include "memory.h"
+#include "instructions.h"
+
+/*
+* Decoded basic block cache.
+* A block is a straight run of instructions that ends at the first jump/call/return/halt (or the end
+* of the memory area it's in). Each one gets decoded once into the handler, its pre-fetched
+* immediates and its cycle count, so running it again doesn't have to go through mem_read and the
+* decode switch for every opcode.
+*
+* Blocks are keyed by (ROM bank, pc), so switching banks never makes a block wrong, it just misses.
+* Only ROM, WRAM and HRAM code gets cached. RAM blocks mark the bytes they cover, and any write to one
+* of those bytes throws away every RAM block.
+*/
+
+struct EmulatorSystem;
+
+#define BLOCK_CACHE_SIZE 4096 //Number of block slots. Has to be a power of 2
+#define BLOCK_MAX_INSTRUCTIONS 16 //Longest block that gets decoded
+
+#define BLOCK_BANK_BOOT 0xFFFF //Bank value used for code in the boot ROM
+#define BLOCK_RAM_CODE_SIZE (0x2000 + 0x80) //WRAM followed by HRAM
+
+//Common instruction sequences that run as one fused entry (see fusion.c)
+typedef enum {
+    FUSE_NONE,
+    FUSE_COPY, //ld a,(hl+) / ld (de),a / inc de
+    FUSE_COPY_COUNT, //ld a,(hl+) / ld (de),a / inc de / dec bc
+    FUSE_POLL, //ldh a,(n) / cp n / jr cc
+    FUSE_COUNTDOWN, //dec r / jr nz
+    FUSION_TYPE_COUNT
+} FusionType;
+
+//Single decoded instruction
+typedef struct {
+    OpcodeHandler handler; //Specialized handler from opcodes.c
+    uint8_t opcode;
+    uint8_t cb_prefix; //1 if opcode is from the CB table
+    uint8_t fetch_length; //Opcode bytes the fetch consumes (2 for CB), the handler fetches the rest itself
+    uint8_t length; //Full instruction length
+    uint8_t cycles; //min_num_cycles
+    uint8_t imm[2]; //Immediates as they were when decoded. Handlers still fetch their own, these are for working out what a block does (idle_loop.c)
+    uint8_t fusion; //FusionType. Set on the first instruction of a fused sequence, the rest stay as they were
+} CachedInstruction;
+
+typedef struct {
+    uint8_t valid;
+    uint8_t in_ram; //Block is in WRAM/HRAM, so writes can invalidate it
+    uint16_t bank;
+    uint16_t start_pc;
+    uint16_t end_pc; //Address right after the last instruction
+    uint16_t total_cycles; //Sum of min_num_cycles for the whole block
+    uint8_t num_instructions;
+    CachedInstruction instructions[BLOCK_MAX_INSTRUCTIONS];
+
+    //Register a side effect free polling loop reads, 0 if this block isn't one (see idle_loop.h)
+    uint16_t idle_address;
+
+    //Ahead of time compiled version of this block (see recomp.h), NULL if there isn't one
+    void (*recompiled)(struct EmulatorSystem* system);
+
+    //JIT state (see jit.h)
+    void* native; //Native translation, NULL if there isn't one
+    uint32_t exec_count; //Times this block ran without a translation
+} CachedBlock;
+
+typedef struct BlockCache BlockCache;
+struct BlockCache {
+    Memory* memory;
+    CachedBlock* blocks;
+
+    //Which WRAM/HRAM bytes are covered by a cached block
+    uint8_t ram_code[BLOCK_RAM_CODE_SIZE];
+    uint16_t num_ram_blocks;
+
+    //Gets bumped whenever cached code might not match memory anymore (bank switch, RAM code write, boot ROM unmap)
+    //so a block that's running can tell it needs to stop
+    uint32_t generation;
+
+    //Whether the linked in recompiled blocks (recomp.h) were built from the ROM that's loaded
+    uint8_t use_recompiled;
+
+    //Stats
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+    uint64_t instructions_run;
+    uint64_t recompiled_runs;
+    uint64_t fusion_hits[FUSION_TYPE_COUNT];
+    uint64_t idle_skips;
+    uint64_t idle_cycles_skipped;
+};
+
+//Arena space memory_init has to set aside for the block cache
+#define BLOCK_CACHE_ARENA_SPACE (ARENA_SPACE(sizeof(BlockCache), ARENA_ALIGNMENT) + \
+    ARENA_SPACE(BLOCK_CACHE_SIZE * sizeof(CachedBlock), ARENA_ALIGNMENT))
+
+BlockCache* block_cache_init(Memory* mem); //Allocated from the Memory arena
+CachedBlock* block_cache_get(BlockCache* cache, uint16_t pc); //Returns NULL if code at pc can't be cached
+void block_cache_flush_ram(BlockCache* cache);
+void block_cache_print_stats(BlockCache* cache);
+
+//Called when the memory map changes under the CPU
+static inline void block_cache_mapping_changed(BlockCache* cache) {
+    ++cache->generation;
+}
+
+//Called on every WRAM/HRAM write. Only does real work if the byte has cached code in it
+static inline void block_cache_ram_write(BlockCache* cache, uint16_t address) {
+    uint16_t offset;
+
+    if (address >= 0xFF80)
+        offset = 0x2000 + (address - 0xFF80);
+    else if (address >= 0xE000)
+        offset = address - 0xE000; //Echo RAM
+    else
+        offset = address - 0xC000;
+
+    if (cache->ram_code[offset])
+        block_cache_flush_ram(cache);
+}
+
+#endif
@@ -1,10 +1,13 @@
+#ifndef CALL_JP_RET_INSTRUCTIONS_H
+#define CALL_JP_RET_INSTRUCTIONS_H
+
 #include "instructions.h"
 
 //Calls function at address
-int call_imm16(CPU* cpu, Instruction* instruction){
+FORCE_INLINE int call_imm16(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t lsb = fetchByte(cpu);
+    uint8_t msb = fetchByte(cpu);
     uint16_t target_address = UNSIGNED_16(lsb, msb);
 
     //Save return address to stack
@@ -19,10 +22,10 @@ int call_imm16(CPU* cpu, Instruction* instruction){
 }
 
 //Calls function at immediate 16-bit address if flag is set/cleared
-int call_flag_imm16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int call_flag_imm16(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t lsb = fetchByte(cpu);
+    uint8_t msb = fetchByte(cpu);
     uint16_t target_address = UNSIGNED_16(lsb, msb);
 
     //Check condition
@@ -44,7 +47,7 @@ int call_flag_imm16(CPU* cpu, Instruction* instruction) {
 }
 
 //Calls function at pre-determined address
-int rst_imm16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rst_imm16(CPU* cpu, Instruction* instruction) {
     //Save return address to stack
     if (!mem_write(cpu->bus, cpu->registers.sp - 1, GET_MSB(cpu->registers.pc), CPU_ACCESS)) { --cpu->registers.sp; }
     if (!mem_write(cpu->bus, cpu->registers.sp - 1, GET_LSB(cpu->registers.pc), CPU_ACCESS)) { --cpu->registers.sp; }
@@ -57,10 +60,10 @@ int rst_imm16(CPU* cpu, Instruction* instruction) {
 }
 
 //Jumps to immediate 16-bit address
-int jp_imm16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int jp_imm16(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t lsb = fetchByte(cpu);
+    uint8_t msb = fetchByte(cpu);
     uint16_t target_address = UNSIGNED_16(lsb, msb);
 
     //Jump
@@ -71,10 +74,10 @@ int jp_imm16(CPU* cpu, Instruction* instruction) {
 }
 
 //Jumps to immediate 16-bit address if flag is set/clear
-int jp_flag_imm16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int jp_flag_imm16(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t lsb = fetchByte(cpu);
+    uint8_t msb = fetchByte(cpu);
     uint16_t target_address = UNSIGNED_16(lsb, msb);
 
     //Check condition
@@ -90,7 +93,7 @@ int jp_flag_imm16(CPU* cpu, Instruction* instruction) {
 }
 
 //Jumps to address stored in Hl
-int jp_hl(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int jp_hl(CPU* cpu, Instruction* instruction) {
     uint16_t address = getRegisterValue16(cpu, REG_HL);
     cpu->registers.pc = address;
 
@@ -99,9 +102,9 @@ int jp_hl(CPU* cpu, Instruction* instruction) {
 }
 
 //Jumps to relative address
-int jr_imm8s(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int jr_imm8s(CPU* cpu, Instruction* instruction) {
     //Get offset
-    int8_t offset = (int8_t)mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    int8_t offset = (int8_t)fetchByte(cpu);
     
     //Jump
     cpu->registers.pc += (int8_t)offset;
@@ -111,9 +114,9 @@ int jr_imm8s(CPU* cpu, Instruction* instruction) {
 }
 
 //Jumps to relative address if flag is set/cleared
-int jr_flag_imm8s(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int jr_flag_imm8s(CPU* cpu, Instruction* instruction) {
     //Get offset
-    int8_t offset = (int8_t)mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    int8_t offset = (int8_t)fetchByte(cpu);
 
     //If flag condition is true jump
     if (flagIsSet(cpu, instruction->first_operand) == instruction->second_operand) {
@@ -128,7 +131,7 @@ int jr_flag_imm8s(CPU* cpu, Instruction* instruction) {
 }
 
 //Returns from function call
-int ret(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ret(CPU* cpu, Instruction* instruction) {
     //Gets return address off stack
     uint8_t lsb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
     uint8_t msb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
@@ -141,7 +144,7 @@ int ret(CPU* cpu, Instruction* instruction) {
 }
 
 //Returns from function call if flag is set/clear
-int ret_flag(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ret_flag(CPU* cpu, Instruction* instruction) {
     //Checks condition then returns if true
     if (flagIsSet(cpu, instruction->first_operand) == instruction->second_operand) {
         //Get address off stack
@@ -159,7 +162,7 @@ int ret_flag(CPU* cpu, Instruction* instruction) {
 }
 
 //Returns from interrupt handler
-int reti(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int reti(CPU* cpu, Instruction* instruction) {
     //Get return address off stack
     uint8_t lsb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
     uint8_t msb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
@@ -172,4 +175,6 @@ int reti(CPU* cpu, Instruction* instruction) {
 
     //0 extra t-cycles
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
@@ -1,10 +1,13 @@
+#ifndef CB_INSTRUCTIONS_H
+#define CB_INSTRUCTIONS_H
+
 #include "instructions.h" 
 
 //Helper functions depending on if register is 8-bit or HL
 //I did these CB intsructions last, but I'm realizing now I could have done something
 //like this EVERYWHERE else and probably cut down on a LOT of different functions I wrote...
 //Oh well, lesson learned! Too late now!
-uint8_t getVal(CPU* cpu, Registers reg) {
+FORCE_INLINE uint8_t getVal(CPU* cpu, Registers reg) {
     uint8_t val;
 
     if (reg == REG_HL)
@@ -15,7 +18,7 @@ uint8_t getVal(CPU* cpu, Registers reg) {
     return val;
 }
 
-void setVal(CPU* cpu, Registers reg, uint8_t result) {
+FORCE_INLINE void setVal(CPU* cpu, Registers reg, uint8_t result) {
     if (reg == REG_HL)
         mem_write(cpu->bus, getRegisterValue16(cpu, reg), result, CPU_ACCESS);
     else
@@ -23,7 +26,7 @@ void setVal(CPU* cpu, Registers reg, uint8_t result) {
 }
 
 //Rotate register value left circular
-int rlc_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rlc_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit7 = val & (1 << 7);
@@ -43,7 +46,7 @@ int rlc_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Rotates register value right circular
-int rrc_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rrc_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit0 = val & 0x1; //Left with the least significant bit, which gets shifted out
@@ -63,7 +66,7 @@ int rrc_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Rotates register value left
-int rl_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rl_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit7 = val & (1 << 7);
@@ -84,7 +87,7 @@ int rl_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Rotates register value right
-int rr_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int rr_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int carry = flagIsSet(cpu, CARRY);
@@ -104,7 +107,7 @@ int rr_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Shift register left arithmetic
-int sla_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sla_r(CPU* cpu, Instruction* instruction) {
     //Get value
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit7 = val >> 7;
@@ -124,7 +127,7 @@ int sla_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Shift register right arithmetic
-int sra_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int sra_r(CPU* cpu, Instruction* instruction) {
     //Get Values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit7 = val & (1 << 7);
@@ -145,7 +148,7 @@ int sra_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Swaps upper and lower nibbles of register
-int swap_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int swap_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     uint8_t result = (val << 4) | (val >> 4);
@@ -164,7 +167,7 @@ int swap_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Shift register right logical
-int srl_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int srl_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->first_operand);
     int bit0 = val & 0x1;
@@ -184,7 +187,7 @@ int srl_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Checks if specified bit is clear or set and updates flags
-int bit_b_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int bit_b_r(CPU* cpu, Instruction* instruction) {
     //Get values 
     uint8_t val = getVal(cpu, instruction->second_operand);
     int result = (val >> instruction->first_operand) & 0x1;
@@ -199,7 +202,7 @@ int bit_b_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Resets bit at specified location
-int res_b_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int res_b_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->second_operand);
     uint8_t result = val & ~(1 << instruction->first_operand);
@@ -212,7 +215,7 @@ int res_b_r(CPU* cpu, Instruction* instruction) {
 }
 
 //Sets bit at specified location
-int set_b_r(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int set_b_r(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t val = getVal(cpu, instruction->second_operand);
     uint8_t result = val | (1 << instruction->first_operand);
@@ -223,3 +226,5 @@ int set_b_r(CPU* cpu, Instruction* instruction) {
     //0 extra t-cycles
     return 0;
 }
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef CORE_STATE_H
+#define CORE_STATE_H
+
+#include <stdint.h>
+
+#include "system_state.h"
+#include "memory_bus.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "apu.h"
+#include "master_clock.h"
+
+/*
+* Core emulator state.
+* The CPU, bus, clock, PPU, APU and the global states they share all used to be their own mallocs, so every
+* tick went jumping all over the heap. Now they're all stored in one block, grouped by how often they get touched.
+* Since tick_hardware only jumps between scheduler events and the timer, PPU and APU catch up when something looks
+* at them, the only things every instruction touches are the time, the scheduler, the CPU and the bus.
+*
+* The usual pointers (system->cpu, ppu->global_state, bus->system_state, etc) are still there and just point
+* into this, so the rest of the code works the same. Nothing in here owns heap memory (the frame buffer and
+* palette are stored inline in the PPU), and everything only points at other things in here or at Memory/SDL,
+* which don't move. The block itself comes out of the Memory arena, so it goes away with it.
+*/
+
+#define CACHE_LINE_SIZE 64
+
+//Starts a member on a new cache line
+#if defined(__GNUC__)
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#elif defined(_MSC_VER)
+#define CACHE_ALIGNED __declspec(align(CACHE_LINE_SIZE))
+#else
+#define CACHE_ALIGNED
+#endif
+
+typedef struct {
+    //Every instruction: tick_hardware reads the time and the next event, and the CPU loop checks whether the
+    //emulator is still running and whether DMA started
+    CACHE_ALIGNED GlobalTimerState timer_state;
+    Scheduler scheduler;
+    GlobalSystemState system_state;
+    GlobalDMAState dma_state;
+    MasterClock sys_clock; //Timer catch-up and the idle/HALT skips
+
+    //Every instruction
+    CACHE_ALIGNED CPU cpu;
+    MemoryBus bus;
+
+    //Only on their own events and when they get caught up, so they sit with the rest of their state
+    CACHE_ALIGNED PPU ppu;
+    GlobalPPUState ppu_state;
+    CACHE_ALIGNED APU apu;
+    GlobalAPUState apu_state;
+} CoreState;
+
+#define CORE_STATE_ARENA_SPACE ARENA_SPACE(sizeof(CoreState), CACHE_LINE_SIZE) //Arena space memory_init has to set aside
+
+CoreState* core_state_init(Memory* mem, SDL_Data* sdl_data); //Allocated from the Memory arena
+
+#endif
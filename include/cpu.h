@@ -2,6 +2,16 @@
 #define CPU_H
 #include <stdint.h>
 #include "memory_bus.h"
+#include "logging.h"
+
+//Forces inlining, which is what lets constant register/flag operands fold away in the opcode handlers
+#if defined(__GNUC__)
+#define FORCE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define FORCE_INLINE static __forceinline
+#else
+#define FORCE_INLINE static inline
+#endif
 
 //Register file struct
 typedef struct {
@@ -26,20 +36,438 @@ typedef struct {
     int halt_bug; //Bug that skips first byte after halt is exited based on interrupt flags
 } LocalCPUState;
 
+#ifdef LAZY_FLAGS
+//Which operation last set the flags
+typedef enum {
+    LAZY_NONE, //F is up to date
+    LAZY_ADD,
+    LAZY_SUB,
+    LAZY_AND,
+    LAZY_OR, //Also XOR, since the flags work the same
+    LAZY_INC,
+    LAZY_DEC
+} LazyFlagOp;
+
+//Instead of working out Z/N/H/C after every ALU op, the op just gets recorded here
+//and F is only worked out when something actually reads it
+typedef struct {
+    uint8_t op; //LazyFlagOp
+    uint8_t first; //Operands
+    uint8_t second;
+    uint8_t carry; //Carry in for ADC/SBC
+    uint16_t result; //Bit 8 is the carry out. INC/DEC just carry over the last op's bit 8 (or C if F is up to date)
+} LazyFlags;
+#endif
+
 typedef struct {
     RegisterFile registers;
     LocalCPUState state;
     MemoryBus* bus;
+#ifdef LAZY_FLAGS
+    LazyFlags lazy_flags;
+#endif
 } CPU;
 
-CPU* cpu_init(MemoryBus*);
-void cpu_destroy(CPU*);
-uint16_t getRegisterValue16(CPU*, Registers);
-uint8_t getRegisterValue8(CPU*, Registers);
-int setRegisterValue(CPU*, Registers, uint16_t);
-int setFlag(CPU*, Flags);
-int clearFlag(CPU*, Flags);
-int updateFlag(CPU*, Flags, int);
-int flagIsSet(CPU*, Flags);
-
-#endif
\ No newline at end of file
+CPU* cpu_init(CPU*, MemoryBus*);
+
+#ifdef LAZY_FLAGS
+void resolveFlags(CPU*); //Works out F from the recorded op
+#endif
+
+//Makes sure F is up to date before anything reads it or changes part of it
+//Does nothing unless the lazy flags build option is on
+FORCE_INLINE void syncFlags(CPU* cpu) {
+#ifdef LAZY_FLAGS
+    if (cpu->lazy_flags.op != LAZY_NONE)
+        resolveFlags(cpu);
+#endif
+}
+
+//Throws away a pending lazy op, for when all of F is about to be overwritten anyway
+FORCE_INLINE void discardFlags(CPU* cpu) {
+#ifdef LAZY_FLAGS
+    cpu->lazy_flags.op = LAZY_NONE;
+#endif
+}
+
+//Reads the byte at pc and moves past it. Goes through the bus's fetch window, so it's usually just a pointer read
+FORCE_INLINE uint8_t fetchByte(CPU* cpu) {
+    return mem_fetch(cpu->bus, cpu->registers.pc++);
+}
+
+/*
+* Register and flag accessors.
+* These are force inlined so that when the register/flag is a constant (which it is in every
+* specialized opcode handler) the switch folds away and it's just a struct field access.
+* The CPU pointer isn't NULL checked anymore since these get called a few times per instruction.
+*/
+
+//Returns the value stored at the register.
+//This will only return values from 16 bit registers!
+//Returns 0 if register is invalid.
+FORCE_INLINE uint16_t getRegisterValue16(CPU* cpu, Registers reg) {
+    uint16_t val = 0;
+
+    switch (reg) {
+        //I don't think A and F are ever treated as the same like this,
+        //but keeping this here for now
+        case REG_AF:
+            syncFlags(cpu);
+            val = ((uint16_t)cpu->registers.A) << 8;
+            val |= cpu->registers.F;
+            break;
+        case REG_BC:
+            val = ((uint16_t)cpu->registers.B) << 8;
+            val |= cpu->registers.C;
+            break;
+        case REG_DE:
+            val = ((uint16_t)cpu->registers.D) << 8;
+            val |= cpu->registers.E;
+            break;
+        case REG_HL:
+            val = ((uint16_t)cpu->registers.H) << 8;
+            val |= cpu->registers.L;
+            break;
+        case REG_sp:
+            val = cpu->registers.sp;
+            break;
+        case REG_pc:
+            val = cpu->registers.pc;
+            break;
+        default:
+            LOG_HOT(LOG_LEVEL_ERROR, "Error: Invalid register! Did you mean to return an 8 bit register?");
+            break;
+    }
+
+    //Returns 0 for invalid register
+    return val;
+}
+
+//Returns the value stored at the register.
+//This only will return values from 8 bit registers!
+//Returns 0 if register is invalid.
+FORCE_INLINE uint8_t getRegisterValue8(CPU* cpu, Registers reg) {
+    uint8_t val = 0;
+
+    //Just like below, this switch statement is icky gross,
+    //but it SHOULD be ideal to handle all of the annoying details
+    switch (reg) {
+        case REG_A:
+            val = cpu->registers.A;
+            break;
+        case REG_B:
+            val = cpu->registers.B;
+            break;
+        case REG_C:
+            val = cpu->registers.C;
+            break;
+        case REG_D:
+            val = cpu->registers.D;
+            break;
+        case REG_E:
+            val = cpu->registers.E;
+            break;
+        case REG_F:
+            syncFlags(cpu);
+            val = cpu->registers.F;
+            break;
+        case REG_H:
+            val = cpu->registers.H;
+            break;
+        case REG_L:
+            val = cpu->registers.L;
+            break;
+        default:
+            LOG_HOT(LOG_LEVEL_ERROR, "Error: Invalid register. Did you mean to return a 16 bit register?");
+            break;
+    }
+
+    //Returns 0 if invalid register.
+    return val;
+}
+
+//Sets register value
+//Handles setting register values of 8 bit or 16 bit to make programming
+//instruction set a little bit easier.
+FORCE_INLINE int setRegisterValue(CPU* cpu, Registers reg, uint16_t value) {
+    //Lots of switch statements here, but ideally the abstraction
+    //will make coding the instructions easier, because there is a LOT of them.
+    //The goal is to keep all the tedious stuff here so that actually writing
+    //and executing the instructions is easy, since that's ultimately the goal
+
+    switch (reg) {
+        case REG_A:
+            cpu->registers.A = (uint8_t)value;
+            break;
+        case REG_B:
+            cpu->registers.B = (uint8_t)value;
+            break;
+        case REG_C:
+            cpu->registers.C = (uint8_t)value;
+            break;
+        case REG_D:
+            cpu->registers.D = (uint8_t)value;
+            break;
+        case REG_E:
+            cpu->registers.E = (uint8_t)value;
+            break;
+        case REG_F:
+            discardFlags(cpu);
+            cpu->registers.F = (uint8_t)value & 0xF0; //Lower nibble always 0
+            break;
+        case REG_H:
+            cpu->registers.H = (uint8_t)value;
+            break;
+        case REG_L:
+            cpu->registers.L = (uint8_t)value;
+            break;
+        case REG_sp:
+            cpu->registers.sp = (uint16_t)value;
+            break;
+        case REG_pc:
+            cpu->registers.pc = (uint16_t)value;
+            break;
+
+        //Special registers
+        //Some registers can be merged together to store 16 bit values
+        case REG_AF:
+            discardFlags(cpu);
+            cpu->registers.A = (uint8_t)(value>>8);
+            cpu->registers.F = (uint8_t)value & 0xF0;
+            break;
+        case REG_BC:
+            cpu->registers.B = (uint8_t)(value>>8);
+            cpu->registers.C = (uint8_t)value;
+            break;
+        case REG_DE:
+            cpu->registers.D = (uint8_t)(value>>8);
+            cpu->registers.E = (uint8_t)value;
+            break;
+        case REG_HL:
+            cpu->registers.H = (uint8_t)(value>>8);
+            cpu->registers.L = (uint8_t)value;
+            break;
+        default:
+            //Return 1 if register value is wrong
+            LOG_HOT(LOG_LEVEL_ERROR, "Error: Invalid register value!");
+            return 1;
+        }
+
+    //Return 0 for success
+    return 0;
+}
+
+//Sets flag values stored in F register
+FORCE_INLINE int setFlag(CPU* cpu, Flags flag) {
+    //Only some of F changes, so any pending lazy flags need to be worked out first
+    if (flag <= CARRY)
+        syncFlags(cpu);
+
+    switch (flag) {
+        case ZERO:
+            cpu->registers.F |= FLAG_ZERO;
+            break;
+        case SUB:
+            cpu->registers.F |= FLAG_SUB;
+            break;
+        case HALFCARRY:
+            cpu->registers.F |= FLAG_HALFCARRY;
+            break;
+        case CARRY:
+            cpu->registers.F |= FLAG_CARRY;
+            break;
+        case IME:
+            cpu->state.IME = 1;
+            break;
+        case ENABLE_IME:
+            cpu->state.enableIME = 1;
+            break;
+        case IS_HALTED:
+            cpu->state.isHalted = 1;
+            break;
+        case HALT_BUG:
+            cpu->state.halt_bug = 1;
+            break;
+        default:
+            LOG_HOT(LOG_LEVEL_ERROR, "Error: Invalid flag!");
+            return 1; //Return 1 for failure
+    }
+
+    return 0;
+}
+
+//Clears flag stored in F register
+FORCE_INLINE int clearFlag(CPU* cpu, Flags flag) {
+    //Only some of F changes, so any pending lazy flags need to be worked out first
+    if (flag <= CARRY)
+        syncFlags(cpu);
+
+    switch (flag) {
+        case ZERO:
+            cpu->registers.F &= ~FLAG_ZERO;
+            break;
+        case SUB:
+            cpu->registers.F &= ~FLAG_SUB;
+            break;
+        case HALFCARRY:
+            cpu->registers.F &= ~FLAG_HALFCARRY;
+            break;
+        case CARRY:
+            cpu->registers.F &= ~FLAG_CARRY;
+            break;
+        case IME:
+            cpu->state.IME = 0;
+            break;
+        case ENABLE_IME:
+            cpu->state.enableIME = 0;
+            break;
+        case IS_HALTED:
+            cpu->state.isHalted = 0;
+            break;
+        case HALT_BUG:
+            cpu->state.halt_bug = 0;
+            break;
+        default:
+            LOG_HOT(LOG_LEVEL_ERROR, "Error: Invalid flag!");
+            return 1; //Failure
+    }
+
+    return 0;
+}
+
+//Updates flag based on boolean input
+FORCE_INLINE int updateFlag(CPU* cpu, Flags flag, int status) {
+    //Expression is FALSE -- Clear flag
+    if (status == 0)
+        clearFlag(cpu, flag);
+    //Expression is TRUE -- Set flag
+    else
+        setFlag(cpu, flag);
+
+    return 0;
+}
+
+//Returns whether a flag is set or not. 1 for set, 0 for clear
+FORCE_INLINE int flagIsSet(CPU* cpu, Flags flag) {
+    //Gets flag value itself
+    //Only reads F for the actual CPU flags, so checking IME and such doesn't resolve lazy flags
+    uint8_t flagVal = (flag <= CARRY) ? getRegisterValue8(cpu, REG_F) : 0;
+
+    //Whether flag is set or not
+    // 0 - Clear; 1 - Set
+    int flagState = 1;
+
+    //Determins if flag is set based on flag input. Again, more switch statements.
+    //I'm kinda relying on them a lot, but again I'm hoping it makes usage easier later.
+    switch(flag) {
+        //Bitwise & to determine if value is 0 and flip flag state
+        case ZERO:
+            if ((flagVal & FLAG_ZERO) == 0)
+                flagState = 0;
+            break;
+        case SUB:
+            if ((flagVal & FLAG_SUB) == 0)
+                flagState = 0;
+            break;
+        case HALFCARRY:
+            if ((flagVal & FLAG_HALFCARRY) == 0)
+                flagState = 0;
+            break;
+        case CARRY:
+            if ((flagVal & FLAG_CARRY) == 0)
+                flagState = 0;
+            break;
+        case IME:
+            //IME is write-only, but I'll keep it for interrupt handling, and for consistency
+            if (cpu->state.IME == 0)
+                flagState = 0;
+            break;
+        case ENABLE_IME:
+            if (cpu->state.enableIME == 0)
+                flagState = 0;
+            break;
+        case IS_HALTED:
+            if (cpu->state.isHalted == 0)
+                flagState = 0;
+            break;
+        case HALT_BUG:
+            if (cpu->state.halt_bug == 0)
+                flagState = 0;
+            break;
+        default:
+            flagState = 0;
+            break;
+    }
+
+    return flagState;
+}
+
+/*
+* Flag helpers for the 8-bit ALU ops.
+* Normally these just write F in one go. With the LAZY_FLAGS build option they only record
+* the operation, and resolveFlags() works F out later if anything ever looks at it.
+*/
+
+//ADD/ADC. Result is the full 16-bit sum so the carry out is kept
+FORCE_INLINE void setAddFlags(CPU* cpu, uint8_t first, uint8_t second, uint8_t carry, uint16_t result) {
+#ifdef LAZY_FLAGS
+    cpu->lazy_flags = (LazyFlags){LAZY_ADD, first, second, carry, result};
+#else
+    cpu->registers.F = (((uint8_t)(result) == 0) ? FLAG_ZERO : 0) |
+        (((first & 0xF) + (second & 0xF) + carry > 0xF) ? FLAG_HALFCARRY : 0) |
+        ((result > 0xFF) ? FLAG_CARRY : 0);
+#endif
+}
+
+//SUB/SBC/CP
+FORCE_INLINE void setSubFlags(CPU* cpu, uint8_t first, uint8_t second, uint8_t carry) {
+#ifdef LAZY_FLAGS
+    //Borrow shows up in bit 8 of the 16-bit difference, same as the carry of an add
+    cpu->lazy_flags = (LazyFlags){LAZY_SUB, first, second, carry, (uint16_t)(first - second - carry)};
+#else
+    cpu->registers.F = FLAG_SUB | (((uint8_t)(first - second - carry) == 0) ? FLAG_ZERO : 0) |
+        (((first & 0xF) < (second & 0xF) + carry) ? FLAG_HALFCARRY : 0) |
+        ((first < (uint16_t)second + carry) ? FLAG_CARRY : 0);
+#endif
+}
+
+//AND/OR/XOR. AND is the only one that sets half carry
+FORCE_INLINE void setLogicFlags(CPU* cpu, uint8_t result, uint8_t half_carry) {
+#ifdef LAZY_FLAGS
+    cpu->lazy_flags = (LazyFlags){half_carry ? LAZY_AND : LAZY_OR, 0, 0, 0, result};
+#else
+    cpu->registers.F = (((uint8_t)(result) == 0) ? FLAG_ZERO : 0) | (half_carry ? FLAG_HALFCARRY : 0);
+#endif
+}
+
+#ifdef LAZY_FLAGS
+//Carry INC and DEC leave alone, kept as bit 8 like every other pending op has it, so F doesn't need working out
+FORCE_INLINE uint16_t lazyCarryBit(CPU* cpu) {
+    if (cpu->lazy_flags.op == LAZY_NONE)
+        return (uint16_t)(cpu->registers.F & FLAG_CARRY) << 4;
+
+    return cpu->lazy_flags.result & 0x100;
+}
+#endif
+
+//INC. Carry is left alone
+FORCE_INLINE void setIncFlags(CPU* cpu, uint8_t val) {
+#ifdef LAZY_FLAGS
+    cpu->lazy_flags = (LazyFlags){LAZY_INC, val, 0, 0, lazyCarryBit(cpu) | (uint8_t)(val + 1)};
+#else
+    cpu->registers.F = (cpu->registers.F & FLAG_CARRY) | (((uint8_t)(val + 1) == 0) ? FLAG_ZERO : 0) |
+        (((val & 0xF) == 0xF) ? FLAG_HALFCARRY : 0);
+#endif
+}
+
+//DEC. Carry is left alone
+FORCE_INLINE void setDecFlags(CPU* cpu, uint8_t val) {
+#ifdef LAZY_FLAGS
+    cpu->lazy_flags = (LazyFlags){LAZY_DEC, val, 0, 0, lazyCarryBit(cpu) | (uint8_t)(val - 1)};
+#else
+    cpu->registers.F = (cpu->registers.F & FLAG_CARRY) | FLAG_SUB | (((uint8_t)(val - 1) == 0) ? FLAG_ZERO : 0) |
+        (((val & 0xF) == 0x0) ? FLAG_HALFCARRY : 0);
+#endif
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdint.h>
+
+#include "memory_bus.h"
+
+/*
+* OAM DMA engine.
+* DMA copies 160 bytes into OAM, one byte every 4 ticks. The CPU can't get to the source or OAM while
+* that's going on (the access masks handle that), so the only thing that could ever see a half done
+* transfer is the PPU. So instead of a read and a write through the bus every 4 ticks, the source block
+* gets resolved to a host pointer once when DMA starts, and bytes only actually get copied (with one memcpy)
+* when the PPU reads OAM or the transfer ends, up to however many bytes would be done by then.
+* Sources that can't be pointed at directly (IO, or anything not mapped as plain memory) still go byte by byte.
+* The pointer is only good until the mapping changes, so an MBC write during a transfer copies what's done so far
+* and switches the rest to byte by byte, which reads through whatever's mapped when each byte happens.
+* Nothing gets ticked while a transfer is going. The end of the transfer (and each byte for the byte by byte
+* sources) is an event on the scheduler.
+*/
+
+#define DMA_LENGTH 0xA0 //Bytes in a transfer
+#define DMA_CYCLES 640 //Ticks in a transfer, 4 per byte
+#define DMA_BYTE_TICK(index) (4 * (uint64_t)(index) + 3) //Tick of the transfer each byte is done on
+
+void dma_start(MemoryBus* bus, uint8_t source);
+void dma_event(MemoryBus* bus, uint64_t time); //Next byte (or the end of the transfer) is due
+void dma_sync(MemoryBus* bus, uint64_t time); //Copies everything that should be in OAM by the given tick
+void dma_mapping_changing(MemoryBus* bus); //Called before a write that could change which memory the source is
+
+#endif
@@ -5,8 +5,10 @@
 
 typedef struct {
     uint8_t active; //DMA active flag
-    uint16_t remaining_cycles; //Remaining cycles for the DMA transfer
+    uint64_t start_time; //Elapsed time of the first tick of the transfer
     uint8_t source; //Source address for DMA transfer
+    uint8_t* source_ptr; //Host pointer to the source block. NULL if it has to be copied byte by byte
+    uint8_t bytes_done; //Bytes already copied into OAM
 } GlobalDMAState;
 
 #endif
\ No newline at end of file
@@ -3,13 +3,34 @@
 #include "system.h" 
 #include "sdl_data.h"
 #include "instructions.h"
+#include "interrupt_handler.h"
+
+#define HALT_MAX_SKIP 0xFFFC //Most ticks a HALTed CPU skips at once. Multiple of 4 that fits in tick_hardware's uint16_t
 
 //This is the fetch, decode, execute loop file that will handle the main instruction loop
 int fe_de_ex(EmulatorSystem* system);
 
 void check_interrupt(EmulatorSystem* system); //Checks for and handles interrupts
+uint16_t halt_ticks(EmulatorSystem* system); //How long a HALTed CPU can skip ahead
 uint8_t fetch_instruction_opcode(EmulatorSystem* system);
 Instruction* decode_instruction(EmulatorSystem* system, uint8_t opcode);
 void execute_instruction(EmulatorSystem* system, Instruction* instr);
 
+#ifndef TABLE_DISPATCH
+void dispatch_instruction(EmulatorSystem* system); //Switch based fetch/decode/execute
+#endif
+
+#if defined(BLOCK_CACHE) && !defined(TABLE_DISPATCH)
+void execute_block(EmulatorSystem* system); //Runs a whole cached block at once
+#endif
+
+//Checked between instructions when running a block. Returns 1 if the main loop would've done something before
+//the next instruction (interrupt, EI, emulator closing), or if the code the block came from might not be there anymore.
+//A pending interrupt with IME off doesn't count, check_interrupt only un-HALTs then and HALT already ends a block
+static inline uint8_t block_should_exit(EmulatorSystem* system, uint32_t generation) {
+    return !system->system_state->running || system->block_cache->generation != generation ||
+        system->system_state->dma_state->active || system->cpu->state.enableIME ||
+        (flagIsSet(system->cpu, IME) && anyInterruptPending(system->memory));
+}
+
 #endif
\ No newline at end of file
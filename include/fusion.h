@@ -0,0 +1,34 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdint.h>
+
+#include "system.h"
+#include "block_cache.h"
+
+/*
+* Superinstructions.
+* After a block gets decoded, common sequences (copy loops, LY/STAT polling, countdowns) get marked so
+* execute_block can run the whole sequence in one go instead of one instruction at a time.
+*
+* Timing stays exact. Anything that touches memory other than its own immediates still gets its ticks
+* right before it runs, like normal. The register only parts in between are what get merged: with IME off,
+* nothing can happen between instructions anyway, so their ticks can all go in one tick_hardware call.
+* With IME on, an interrupt could land between any two of them, so those just get ticked and checked one
+* at a time like execute_block would.
+*/
+
+//Describes one fused sequence
+typedef struct {
+    const char* name; //For stats
+    uint8_t length; //Number of instructions
+    uint8_t timed_mask; //Instructions that access memory, so they need their ticks to land exactly before them
+    uint8_t write_mask; //Instructions that write memory, so the block might have to stop right after them
+} FusionPattern;
+
+extern const FusionPattern fusion_patterns[FUSION_TYPE_COUNT];
+
+void fuse_block(CachedBlock* block); //Marks fused sequences in a freshly decoded block
+int run_fused(EmulatorSystem* system, CachedInstruction* instr, uint32_t generation); //Returns how many instructions ran
+
+#endif
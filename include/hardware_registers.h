@@ -5,11 +5,20 @@
 //Defines and encapsulates the read/write information
 //for the hardware registers in the range 0xFF00 - 0xFFFF
 
+struct MemoryBus;
+
+//Side effects of accessing a register. NULL for plain registers that don't do anything special
+//Write handlers get the masked value and return what actually gets stored, read handlers return what gets read
+typedef uint8_t (*HwWriteHandler)(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+typedef uint8_t (*HwReadHandler)(struct MemoryBus* bus, uint16_t address, uint8_t val);
+
 //Struct for information
 typedef struct {
     uint8_t read_mask;
     uint8_t write_mask;
     uint8_t cgb_only;
+    HwWriteHandler write;
+    HwReadHandler read;
 } HardwareRegister;
 
 //Table and populate function
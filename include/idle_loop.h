@@ -0,0 +1,31 @@
+#ifndef IDLE_LOOP_H
+#define IDLE_LOOP_H
+
+#include <stdint.h>
+
+#include "system.h"
+#include "block_cache.h"
+
+/*
+* Idle loop skipping.
+* Lots of games sit in loops like "ldh a,(LY) / cp 144 / jr nz" waiting on the hardware. Every pass
+* through one of those reads the same value and leaves the CPU in the same state, so once one pass has
+* run, the rest are just time passing until the polled register can change.
+*
+* A block counts as an idle loop if it jumps back to itself, starts with a read of LY, STAT, IF, DIV
+* or TIMA, and everything else in it only works on A and the flags (cp n, and n, bit b,a). When one runs,
+* a single pass goes through normally, then the PPU/timer get asked how many ticks are left before that
+* register can change, and every pass that would still read the old value is replaced with one
+* tick_hardware call. The hardware still gets every tick, so timer, PPU and APU state is exactly what
+* it would've been.
+*
+* This only happens when no interrupt can fire in between (IME off, or nothing enabled in IE), since
+* otherwise one could land in the middle of the skipped passes.
+*/
+
+#define IDLE_MAX_SKIP 0xFFFF //Most ticks skipped at once, since tick_hardware takes a uint16_t
+
+void detect_idle_loop(CachedBlock* block); //Sets block->idle_address if the block is an idle loop
+uint8_t run_idle_loop(EmulatorSystem* system, CachedBlock* block); //Returns 0 if the block has to run normally instead
+
+#endif
@@ -2,9 +2,22 @@
 #define INIT_H
 
 #include "system.h" 
+#include "logging.h"
+
+//Command line options
+typedef struct {
+    const char* rom_path; //ROM to load, defaults to game.gb
+    uint8_t use_jit; //--jit turns on the dynamic recompiler
+    uint32_t frame_limit; //--frames N quits after N frames and prints how long it took. 0 runs until closed
+    uint32_t save_interval; //--save-interval MS is how often battery saves get flushed to disk. 0 only flushes on close
+    LogLevel log_level; //--log-level NAME is the least important kind of message that still gets logged
+} EmulatorOptions;
+
+int parse_options(int argc, char** argv, EmulatorOptions* options);
+void print_usage();
 
 //Sets up initial emulator conditions
-int emulator_init();
+int emulator_init(EmulatorOptions* options);
 int init_cpu_vals(EmulatorSystem* system);
 
 #endif
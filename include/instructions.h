@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include "cpu.h"
+#include "opcode_table.h"
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -59,134 +60,20 @@ extern Instruction cb_instructions[256];
 void init_opcodes(); //Populates instruction tables in opcodes.c
 
 //Instruction functions
-//Returns number of T-states instruction took
+//Returns number of extra T-states the instruction took (ie, a taken branch)
+//The actual handlers are force inlined in the *_instructions.h headers, and only opcodes.c includes them.
+//That way opcodes.c can build a copy of each handler per opcode with the operands baked in.
 
-//Load instructions             //dest|src
-int ld_r16_imm16(CPU*, Instruction*); //16-bit register|16-bit immediate
-int ld_r16mem_r8(CPU*, Instruction*); //[16-bit register]|8-bit register
-int ld_r8_imm8(CPU*, Instruction*); //8-bit register|8-bit immediate
-int ld_r16mem_imm8(CPU*, Instruction*); //[16-bit register]|8-bit immediate
-int ld_mem_r16(CPU*, Instruction*); //[16-bit address]|16-bit register
-int ld_r8_r16mem(CPU*, Instruction*); //8-bit register|[16-bit register]
-int ld_r8_r8(CPU*, Instruction*); //8-bit register|8-bit register
-int ld_r8_mem(CPU*, Instruction*); //8-bit register|[16-bit address]
-int ld_mem_r8(CPU*, Instruction*);
+//Specialized handlers, one per opcode, generated in opcodes.c from opcode_table.h
+#define DECLARE_MAIN_HANDLER(opcode, function, first_op, second_op, size, cycles) int main_op_##opcode(CPU* cpu);
+#define DECLARE_CB_HANDLER(opcode, function, first_op, second_op, size, cycles) int cb_op_##opcode(CPU* cpu);
 
-int ld_r16_r16(CPU*, Instruction*); //16-bit register|16-bit register
-int ld_r16_imm8s(CPU*, Instruction*); //16-bit register|SP + 8-bit signed immediate
+MAIN_OPCODE_TABLE(DECLARE_MAIN_HANDLER)
+CB_OPCODE_TABLE(DECLARE_CB_HANDLER)
 
-int ld_r16meminc_r8(CPU*, Instruction*); //[16-bit register] (inc register)|8-bit register
-int ld_r16memdec_r8(CPU*, Instruction*); //[16-bit register] (dec register)|8-bit register
-int ld_r8_r16meminc(CPU*, Instruction*); //8-bit register|[16-bit register] (inc register)
-int ld_r8_r16memdec(CPU*, Instruction*); //8-bit register|[16-bit register] (dec register)
-
-int ldh_mem_r8(CPU*, Instruction*); //[0xFF00 + 8-bit address]|8-bit register
-int ldh_r8_mem(CPU*, Instruction*); //8-bit register|[0xFF00 + 8-bit address]
-int ldh_r8mem_r8(CPU*, Instruction*); //[0xFF00 + 8-bit register]|8-bit register
-int ldh_r8_r8mem(CPU*, Instruction*); //8-bit register|[0xFF00 + 8-bit register]
-
-//Push/Pop instructions
-int push(CPU*, Instruction*);
-int pop(CPU*, Instruction*);
-
-//Arithmetic Instructions
-int add_r8_r8(CPU*, Instruction*);
-int add_r8_r16mem(CPU*, Instruction*);
-int add_r8_imm8(CPU*, Instruction*);
-int add_r16_r16(CPU*, Instruction*);
-int add_r16_imm8s(CPU*, Instruction*); //Adds SP to signed int
-
-int adc_r8_r8(CPU*, Instruction*);
-int adc_r8_r16mem(CPU*, Instruction*);
-int adc_r8_imm8(CPU*, Instruction*);
-
-int sub_r8_r8(CPU*, Instruction*);
-int sub_r8_r16mem(CPU*, Instruction*);
-int sub_r8_imm8(CPU*, Instruction*);
-
-int sbc_r8_r8(CPU*, Instruction*);
-int sbc_r8_r16mem(CPU*, Instruction*);
-int sbc_r8_imm8(CPU*, Instruction*);
-
-int cp_r8_r8(CPU*, Instruction*);
-int cp_r8_r16mem(CPU*, Instruction*);
-int cp_r8_imm8(CPU*, Instruction*);
-
-//Bitwise Instructions
-int and_r8_r8(CPU*, Instruction*);
-int and_r8_r16mem(CPU*, Instruction*);
-int and_r8_imm8(CPU*, Instruction*);
-
-int xor_r8_r8(CPU*, Instruction*);
-int xor_r8_r16mem(CPU*, Instruction*);
-int xor_r8_imm8(CPU*, Instruction*);
-
-int or_r8_r8(CPU*, Instruction*);
-int or_r8_r16mem(CPU*, Instruction*);
-int or_r8_imm8(CPU*, Instruction*);
-
-//Increment/Decrement
-int inc_r16(CPU*, Instruction*);
-int inc_r8(CPU*, Instruction*);
-int inc_r16mem(CPU*, Instruction*);
-int dec_r16(CPU*, Instruction*);
-int dec_r8(CPU*, Instruction*);
-int dec_r16mem(CPU*, Instruction*);
-
-//Accumulator rotation
-int rrca(CPU*, Instruction*); //rotate right circular
-int rra(CPU*, Instruction*); //rotate right, rotate in carry bit
-int rlca(CPU*, Instruction*); //rotate left circular
-int rla(CPU*, Instruction*); //rotate left, rotate in carry bit
-
-//Call instructions
-int call_imm16(CPU*, Instruction*); //Calls function at imm16
-int call_flag_imm16(CPU*, Instruction*); //Calls function at imm16 if flag is set
-
-int rst_imm16(CPU*, Instruction*); //Jump to hard coded addresses
-
-//Absolute Jump
-int jp_imm16(CPU*, Instruction*); //Unconditional jump to address
-int jp_flag_imm16(CPU*, Instruction*); //Jump if flag is set
-int jp_hl(CPU*, Instruction*); //Outlier that jumps to the address stored in HL
-
-//Relative Jump
-int jr_imm8s(CPU*, Instruction*); //Unconditionaly
-int jr_flag_imm8s(CPU*, Instruction*); //If flag
-
-//Return Instructions
-int ret(CPU*, Instruction*); //Unconditional
-int ret_flag(CPU*, Instruction*); //Return if flag is set
-
-int reti(CPU*, Instruction*); //Return from interrupt handler
-
-//Misc instructions (wasnt sure how to caregorize these)
-int cpl(CPU*, Instruction*); //Complement accumulator (A register)
-int ccf(CPU*, Instruction*); //Complement carry flag
-int scf(CPU*, Instruction*); //Set carry flag
-int daa(CPU*, Instruction*); //Decimal adjust accumulator
-
-int stop(CPU*, Instruction*);
-int halt(CPU*, Instruction*);
-int nop(CPU*, Instruction*);
-
-int di(CPU*, Instruction*);
-int ei(CPU*, Instruction*);
-
-
-//CB Instructions
-//The GameBoy has different instructions for the CB prefix, so I'm going 
-//to handle these separately, but they are really kinda nothing new.
-int rlc_r(CPU*, Instruction*);
-int rrc_r(CPU*, Instruction*);
-int rl_r(CPU*, Instruction*);
-int rr_r(CPU*, Instruction*);
-int sla_r(CPU*, Instruction*);
-int sra_r(CPU*, Instruction*);
-int swap_r(CPU*, Instruction*);
-int srl_r(CPU*, Instruction*);
-int bit_b_r(CPU*, Instruction*);
-int res_b_r(CPU*, Instruction*);
-int set_b_r(CPU*, Instruction*);
+//Same handlers, but as lookup tables for things that decode ahead of time (ie, the block cache)
+typedef int (*OpcodeHandler)(CPU*);
+extern OpcodeHandler main_op_handlers[256];
+extern OpcodeHandler cb_op_handlers[256];
 
 #endif
\ No newline at end of file
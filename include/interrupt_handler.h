@@ -14,10 +14,37 @@ typedef enum {
     INTERRUPT_JOYPAD = 4
 } Interrupt;
 
+#define INTERRUPT_MASK 0x1F //Only the bottom 5 bits of IE and IF are actual interrupts
+
+//Index of the lowest set bit, which is also the highest priority interrupt in a pending mask. Mask can't be 0
+static inline int lowestSetBit(unsigned int mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!((mask >> bit) & 0x1)) { ++bit; }
+    return bit;
+#endif
+}
+
 void serviceInterrupt(CPU*);
-int interruptPending(Interrupt, Memory*);
-int anyInterruptPending(Memory*);
 void requestInterrupt(Interrupt, Memory*);
 void clearInterrupt(Interrupt, Memory*);
+void updatePendingInterrupts(Memory*); //Has to be called whenever IE or IF gets written
+
+/*
+* IE & IF is kept in one byte (pending_interrupts) instead of being worked out each time,
+* since these get checked before every instruction
+*/
+
+//Checks if specific interrupt can be serviced
+static inline int interruptPending(Interrupt interrupt, Memory* mem) {
+    return (mem->local_state.pending_interrupts >> interrupt) & 0x01;
+}
+
+//Checks if there are ANY interrupts that can be serviced
+static inline int anyInterruptPending(Memory* mem) {
+    return mem->local_state.pending_interrupts != 0;
+}
 
 #endif
\ No newline at end of file
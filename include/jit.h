@@ -0,0 +1,62 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "system.h"
+#include "block_cache.h"
+
+/*
+* x86-64 dynamic recompiler.
+* Hot ROM blocks from the block cache get translated into native code. Every instruction still ticks
+* the hardware before it runs, exactly like execute_instruction does, so timing doesn't change at all.
+* What goes away is the per-instruction loop overhead: the pc update, the cycle count and all of the
+* "should I stop now" checks are baked into the native code as constants. The loads and the 8-bit ALU
+* ops are emitted directly instead of calling their handler, with F coming straight from the host flags
+* and memory operands going through mem_read/mem_write. Everything else still calls its handler.
+*
+* The buffer is W^X: pages only get made writable while a translation is being written into them,
+* and go back to read/execute before anything runs.
+*
+* Only ROM blocks get translated. ROM can't change under a (bank, pc) key, so a translation stays good
+* until the slot gets reused. Bank switches and RAM code writes still bump the block cache generation,
+* which the native code checks after every instruction, so it bails out the same way execute_block does.
+*
+* Needs x86-64 with the System V calling convention and mmap, so it's Linux only for now.
+* Everywhere else (or if BLOCK_CACHE is off) jit_init just fails and the interpreter runs instead.
+*/
+
+#if defined(BLOCK_CACHE) && defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#endif
+
+#define JIT_BUFFER_SIZE (4 * 1024 * 1024) //Executable memory for translations
+#define JIT_MAX_BLOCK_SIZE 4096 //Most bytes a single translation can take
+#define JIT_MAX_INSTRUCTION_SIZE 384 //Most bytes one instruction can take, exit checks included. SBC A,(HL) with LAZY_FLAGS is ~290
+#define JIT_HOT_THRESHOLD 16 //Times a block runs in the interpreter before it gets translated
+
+typedef void (*JitBlockFn)(void);
+
+typedef struct JIT JIT;
+struct JIT {
+    EmulatorSystem* system;
+    BlockCache* cache;
+
+    uint8_t* buffer; //mmap'd code memory
+    size_t used; //Bytes of buffer that are taken
+    size_t page_size;
+
+    //Stats
+    uint64_t translations;
+    uint64_t native_runs;
+    uint64_t flushes;
+};
+
+JIT* jit_init(EmulatorSystem* system);
+void jit_destroy(JIT* jit);
+uint8_t jit_run_block(JIT* jit, CachedBlock* block); //Returns 1 if the block ran natively, 0 if the interpreter has to run it
+void jit_flush(JIT* jit); //Throws away every translation
+void jit_print_stats(JIT* jit);
+
+#endif
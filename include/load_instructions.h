@@ -1,10 +1,13 @@
+#ifndef LOAD_INSTRUCTIONS_H
+#define LOAD_INSTRUCTIONS_H
+
 #include "instructions.h"
 
 //Loads 16-bit immediate from memory into 16-bit register
-int ld_r16_imm16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16_imm16(CPU* cpu, Instruction* instruction) {
     //Get immediate from memory
-    uint8_t src_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t src_msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_lsb = fetchByte(cpu);
+    uint8_t src_msb = fetchByte(cpu);
 
     //Store in register
     setRegisterValue(cpu, instruction->first_operand, UNSIGNED_16(src_lsb, src_msb));
@@ -14,7 +17,7 @@ int ld_r16_imm16(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value in 8-bit register to address stored in 16-bit register
-int ld_r16mem_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16mem_r8(CPU* cpu, Instruction* instruction) {
     //Get values from registers
     uint16_t dest_address = getRegisterValue16(cpu, instruction->first_operand);
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
@@ -27,9 +30,9 @@ int ld_r16mem_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads 8-bit immediate from memory into 8-bit register
-int ld_r8_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_imm8(CPU* cpu, Instruction* instruction) {
     //Get immediate from memory
-    uint8_t src_val = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_val = fetchByte(cpu);
 
     //Store value in register
     setRegisterValue(cpu, instruction->first_operand, src_val);
@@ -39,10 +42,10 @@ int ld_r8_imm8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads 8-bit immediate from memory into memory at address stored in 16-bit register
-int ld_r16mem_imm8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16mem_imm8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t dest_address = getRegisterValue16(cpu, instruction->first_operand); //from register
-    uint8_t src_val = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS); //From memory
+    uint8_t src_val = fetchByte(cpu); //From memory
 
     //Writes value
     mem_write(cpu->bus, dest_address, src_val, CPU_ACCESS);
@@ -52,10 +55,10 @@ int ld_r16mem_imm8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 16-bit register into 16-bit immediate address
-int ld_mem_r16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_mem_r16(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t dest_address_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t dest_address_msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t dest_address_lsb = fetchByte(cpu);
+    uint8_t dest_address_msb = fetchByte(cpu);
     uint16_t dest_address = UNSIGNED_16(dest_address_lsb, dest_address_msb);
     uint16_t src_val = getRegisterValue16(cpu, instruction->first_operand);
 
@@ -68,7 +71,7 @@ int ld_mem_r16(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from address stored in 16-bit register into 8-bit register
-int ld_r8_r16mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_r16mem(CPU* cpu, Instruction* instruction) {
     //Get value
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     
@@ -80,7 +83,7 @@ int ld_r8_r16mem(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8 bit register into 8 bit register
-int ld_r8_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
 
@@ -92,10 +95,10 @@ int ld_r8_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from immediate address into 8-bit register
-int ld_r8_mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_mem(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t src_address_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t src_address_msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_address_lsb = fetchByte(cpu);
+    uint8_t src_address_msb = fetchByte(cpu);
     uint8_t src_val = mem_read(cpu->bus, UNSIGNED_16(src_address_lsb, src_address_msb), CPU_ACCESS);
 
     //Store value
@@ -106,10 +109,10 @@ int ld_r8_mem(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8 bit register into 16-bit immediate address
-int ld_mem_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_mem_r8(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t dest_address_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
-    uint8_t dest_address_msb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t dest_address_lsb = fetchByte(cpu);
+    uint8_t dest_address_msb = fetchByte(cpu);
     uint8_t src_val = getRegisterValue8(cpu, instruction->first_operand);
 
     //Set value
@@ -120,7 +123,7 @@ int ld_mem_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 16-bit register into 16-bit register
-int ld_r16_r16(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16_r16(CPU* cpu, Instruction* instruction) {
     //Get Values
     uint16_t src_val = getRegisterValue16(cpu, instruction->second_operand);
 
@@ -132,9 +135,9 @@ int ld_r16_r16(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads sp + signed 8-bit value into 16-bit register
-int ld_r16_imm8s(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16_imm8s(CPU* cpu, Instruction* instruction) {
     //Get values
-    int8_t src_offset = (int8_t)(mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS));
+    int8_t src_offset = (int8_t)(fetchByte(cpu));
     uint16_t src_val = cpu->registers.sp + src_offset;
 
     //Store value
@@ -153,7 +156,7 @@ int ld_r16_imm8s(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8 bit register into memory address stored in 16-bit register, then increments the register
-int ld_r16meminc_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16meminc_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t dest_address = getRegisterValue16(cpu, instruction->first_operand);
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
@@ -169,7 +172,7 @@ int ld_r16meminc_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8-bit register into address stored in 16-bit register, then decrements the 16-bit register
-int ld_r16memdec_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r16memdec_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t dest_address = getRegisterValue16(cpu, instruction->first_operand);
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
@@ -185,7 +188,7 @@ int ld_r16memdec_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from memory address in 16-bit register into 8-bit register, then increments the 16-bit register
-int ld_r8_r16meminc(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_r16meminc(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t src_val = mem_read(cpu->bus, src_address, CPU_ACCESS);
@@ -201,7 +204,7 @@ int ld_r8_r16meminc(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from address in 16-bit register into 8-bit register, then decrements the 16-bit register
-int ld_r8_r16memdec(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ld_r8_r16memdec(CPU* cpu, Instruction* instruction) {
     //Get values
     uint16_t src_address = getRegisterValue16(cpu, instruction->second_operand);
     uint8_t src_val = mem_read(cpu->bus, src_address, CPU_ACCESS);
@@ -217,9 +220,9 @@ int ld_r8_r16memdec(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8-bit register into memory address at 0xFF00 + 8-bit immediate
-int ldh_mem_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ldh_mem_r8(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t dest_address_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t dest_address_lsb = fetchByte(cpu);
     uint8_t src_val = getRegisterValue8(cpu, instruction->first_operand);
 
     //Write value
@@ -230,9 +233,9 @@ int ldh_mem_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from memory at 0xFF00 + 8-bit immediate into 8-bit register
-int ldh_r8_mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ldh_r8_mem(CPU* cpu, Instruction* instruction) {
     //Get values
-    uint8_t src_address_lsb = mem_read(cpu->bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t src_address_lsb = fetchByte(cpu);
     uint8_t src_val = mem_read(cpu->bus, UNSIGNED_16(src_address_lsb, 0xFF), CPU_ACCESS);
 
     //Set value
@@ -243,7 +246,7 @@ int ldh_r8_mem(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from 8-bit register into address at 0xFF00 + value in 8-bit register
-int ldh_r8mem_r8(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ldh_r8mem_r8(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t src_val = getRegisterValue8(cpu, instruction->second_operand);
     uint8_t dest_address_lsb = getRegisterValue8(cpu, instruction->first_operand);
@@ -256,7 +259,7 @@ int ldh_r8mem_r8(CPU* cpu, Instruction* instruction) {
 }
 
 //Loads value from address at 0xFF00 + value stored in 8-bit register into 8-bit register
-int ldh_r8_r8mem(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ldh_r8_r8mem(CPU* cpu, Instruction* instruction) {
     //Get values
     uint8_t src_address_lsb = getRegisterValue8(cpu, instruction->second_operand);
     uint8_t src_val = mem_read(cpu->bus, UNSIGNED_16(src_address_lsb, 0xFF), CPU_ACCESS);
@@ -269,7 +272,7 @@ int ldh_r8_r8mem(CPU* cpu, Instruction* instruction) {
 }
 
 //Pushes value of 16-bit register onto stack
-int push(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int push(CPU* cpu, Instruction* instruction) {
     //Get value
     uint16_t src_val = getRegisterValue16(cpu, instruction->first_operand);
 
@@ -282,7 +285,7 @@ int push(CPU* cpu, Instruction* instruction) {
 }
 
 //Pops value off stack into 16-bit register
-int pop(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int pop(CPU* cpu, Instruction* instruction) {
     //Get values from stack
     uint8_t src_val_lsb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
     uint8_t src_val_msb = mem_read(cpu->bus, cpu->registers.sp++, CPU_ACCESS);
@@ -292,4 +295,6 @@ int pop(CPU* cpu, Instruction* instruction) {
 
     //0 extra t-cycles
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
@@ -1,6 +1,45 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
-void printError(char* msg);
+#include <stdint.h>
 
-#endif
\ No newline at end of file
+/*
+* Logging.
+* Messages go into a ring buffer and get written to stderr by a background thread, so logging never waits on
+* a syscall (or a lock) on the emulator thread. Before log_init and after log_shutdown (or on builds without
+* threads) they just get written straight away.
+*
+* Stuff that can happen on every access or instruction (bad memory reads, invalid registers) uses LOG_HOT instead.
+* Each LOG_HOT has its own counter, and only the first few hits and then every power of 2 actually get logged, so a
+* game polling VRAM in mode 3 can't flood anything. Unless HOT_PATH_LOGGING is defined, LOG_HOT compiles to nothing.
+*/
+
+typedef enum {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG
+} LogLevel;
+
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_WARNING
+#define LOG_SITE_BURST 4 //Hits a LOG_HOT always logs before it only logs on powers of 2
+
+//Per call site state for LOG_HOT
+typedef struct {
+    uint32_t hits;
+} LogSite;
+
+uint8_t log_init(LogLevel level); //Starts the background writer. Returns 0 for success, 1 for failure
+void log_shutdown(); //Writes anything left and stops the writer
+void log_flush(); //Writes everything queued so far before returning
+void log_message(LogLevel level, const char* msg);
+void log_site_hit(LogSite* site, LogLevel level, const char* msg);
+uint8_t log_parse_level(const char* name, LogLevel* level); //Returns 0 for success, 1 if the name isn't a level
+
+#ifdef HOT_PATH_LOGGING
+#define LOG_HOT(level, msg) do { static LogSite log_site_; log_site_hit(&log_site_, level, msg); } while (0)
+#else
+#define LOG_HOT(level, msg) ((void)0)
+#endif
+
+#endif
@@ -5,30 +5,43 @@
 #include "memory.h"
 #include "ppu.h"
 #include "apu.h"
+#include "scheduler.h"
 
 /*
 * Master clock takes care of timing, including the system time, the amount of cycles total, and the time 
 * of the current frame. This is also directly tied to the timing registers
 */
 
-//Holds flags for timing registers
-typedef struct {
-    uint8_t prev_tac_bit; //Stores what the last Timer Control bit was for updating TIMA
-    uint8_t prev_tma_val; //Stores previous M-Cycle's TMA value for TIMA overflow
-
-    uint8_t tima_overflow; //Flag to check whether TIMA overflowed
-    uint8_t tima_overflow_buffer; //Flag to check if TIMA overflowed 2 cycles ago for TIMA updates
-} LocalTimerState;
+/*
+* Lazy timer.
+* DIV and TIMA don't get updated every tick. The system time is just the ticks since DIV was last written, and the
+* registers get worked out from that whenever something reads or writes DIV, TIMA, TMA or TAC (timer_catch_up).
+* Catching up goes straight from one TIMA increment to the next instead of going tick by tick.
+* The only thing that has to happen on time is the timer interrupt, so the tick TIMA gets reloaded after an overflow
+* is posted as EVENT_TIMER, and gets posted again whenever the timer registers get written.
+*/
 
 //Holds system timing information
 typedef struct {
     //Timer states
     GlobalTimerState* global_state;
-    LocalTimerState local_state;
 } MasterClock;
 
-MasterClock* master_clock_init(GlobalTimerState* global_state);
-void master_clock_destroy(MasterClock* clock);
-void update_timing_registers(MasterClock* clock, Memory* mem);
+MasterClock* master_clock_init(MasterClock* sys_clock, GlobalTimerState* global_state);
+uint8_t get_tac_bit_pos(uint8_t tac_value);
+
+void timer_catch_up(GlobalTimerState* timer, Memory* mem, uint64_t time); //Updates the timer registers for every tick before time
+void timer_post_overflow(GlobalTimerState* timer, Memory* mem, Scheduler* scheduler); //Reposts EVENT_TIMER. Timer has to be caught up
+void timer_event(GlobalTimerState* timer, Memory* mem, Scheduler* scheduler, uint64_t time); //TIMA gets reloaded
+
+//System time on a given tick
+static inline uint16_t timer_system_time(const GlobalTimerState* timer, uint64_t time) {
+    return (uint16_t)(time - timer->div_reset_time);
+}
+
+//How many upcoming ticks leave the timer registers the same. Used for skipping idle time
+uint32_t timer_ticks_until_div_change(MasterClock* clock, Memory* mem);
+uint32_t timer_ticks_until_tima_change(MasterClock* clock, Memory* mem);
+uint32_t timer_ticks_until_overflow(MasterClock* clock, Memory* mem); //Ticks before the timer interrupt can be requested
 
 #endif 
\ No newline at end of file
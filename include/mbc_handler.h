@@ -2,7 +2,9 @@
 #define MBC_HANDLER_H 
 
 #include "hardware_def.h"
+#include "rtc.h"
 #include <stdint.h>
+#include <stdio.h>
 
 /*
 * Different cartridges have different layouts and rules for their banked memory, so
@@ -18,8 +20,30 @@ typedef struct {
     uint8_t mbc_ram_size_byte;
 } MBC_Data;
 
-//Stores information regarding memory banking
+#define EXRAM_WINDOW_MASK 0x1FFF //Offset mask for an EXRAM bank that fills the whole window
+
+typedef struct MBC MBC;
+
+/*
+* MBC interface.
+* Each MBC type gets one of these in mbc_init, so writes don't have to switch on the type every time.
+* write only gets called for writes to 0x0000-0x7FFF and the EXRAM window, and whenever a write changes
+* a bank, update_banks works out the new bank pointers right there, so reads are just an offset from them.
+* save and load handle anything the MBC keeps in the save file after EXRAM (like the RTC). load gets the file
+* already at the right spot, save just fills in a buffer so it can go through the save file's flusher too.
+* EXRAM itself is handled by Memory.
+*/
+
+#define MBC_SAVE_TRAILER_MAX RTC_SAVE_SIZE //Most bytes an MBC keeps after EXRAM
 typedef struct {
+    void (*write)(MBC*, uint16_t, uint8_t); //Handles writes to the MBC's registers
+    void (*update_banks)(MBC*); //Recomputes the bank pointers from the current banks
+    uint8_t (*load)(MBC*, FILE*); //Loads extra save data. Returns 0 for success, 1 for failure
+    size_t (*save)(MBC*, uint8_t*); //Fills in extra save data (up to MBC_SAVE_TRAILER_MAX bytes). Returns how many
+} MBC_Interface;
+
+//Stores information regarding memory banking
+struct MBC {
     //Metadata info from cartridge header
     MBC_Data* mbc_data;
 
@@ -36,15 +60,37 @@ typedef struct {
     uint8_t current_exram_bank;
     uint8_t num_exram_banks;
     uint8_t exram_enabled; //Specifies if this is enabled
-} MBC;
+
+    //Memory the banks are in. Owned by the Memory struct, the MBC just points into it
+    uint8_t* rom;
+    uint8_t* exram;
+    uint32_t exram_size; //Size of EXRAM in bytes. 0 if there isn't any
+    uint16_t exram_mask; //Mask for offsets into the EXRAM window (MBC2 only has 0x200 bytes, an RTC register is 1)
+
+    //Resolved pointers for the current banks
+    uint8_t* rom_bank_0; //0x0000-0x3FFF
+    uint8_t* rom_bank_x; //0x4000-0x7FFF
+    uint8_t* exram_bank; //0xA000-0xBFFF, NULL if there's no EXRAM
+
+    //MBC3 real time clock
+    RTC rtc;
+    uint8_t rtc_select; //RTC register mapped into the EXRAM window, 0 if it's a RAM bank instead
+
+    const MBC_Interface* interface;
+};
 
 //Sets up MBC chip information
-MBC* mbc_init(MBC_Data* data);
-void mbc_destroy(MBC*);
+MBC* mbc_init(MBC* mbc, MBC_Data* data);
+uint32_t mbc_exram_size(const MBC_Data* data); //EXRAM size from the header, before there's an MBC
+void mbc_set_memory(MBC* mbc, uint8_t* rom, uint8_t* exram); //Gives the MBC the memory its banks are in
+
+//Handles writes to the MBC's registers
+static inline void mbc_write(MBC* mbc, uint16_t address, uint8_t value) {
+    mbc->interface->write(mbc, address, value);
+}
 
-//Determines current bank
+//Register write handlers for each MBC
 //For MBC1, it will also handle switching modes
-void update_current_bank(MBC*, uint16_t, uint8_t);
 void update_mbc1_data(MBC*, uint16_t, uint8_t);
 void update_mbc2_data(MBC*, uint16_t, uint8_t);
 void update_mbc3_data(MBC*, uint16_t, uint8_t);
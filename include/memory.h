@@ -6,6 +6,7 @@
 
 #include "mbc_handler.h"
 #include "sdl_data.h"
+#include "arena.h"
 
 //Memory emulation
 
@@ -75,6 +76,7 @@ typedef struct {
     uint8_t boot_rom_mapped; //Bootrom flag
     uint8_t button_state; //Current state of non-dpad buttons
     uint8_t dpad_state; //Current state of dpad buttons
+    uint8_t pending_interrupts; //IE & IF. Kept up to date by the interrupt handler whenever either one changes
 } LocalMemoryState;
 
 //Memory struct to hold different memory mappings.
@@ -97,8 +99,11 @@ typedef struct {
     uint8_t* hram; //hram. Final index is the interrupt enable register.
 
     //Switchable banks
+    struct RomImage* rom_image; //Where rom_x comes from. Shared, so rom_x is read only
     uint8_t* rom_x;
     uint8_t* exram_x;
+    struct SaveFile* save_file; //Save file exram_x is mapped from. NULL if it's just in memory
+    uint8_t save_in_use; //Another emulator has the save file, so this one never writes it
 
     //Boot ROM to set initial values
     uint8_t* boot_rom;
@@ -106,14 +111,19 @@ typedef struct {
 
     //Other memory flags
     LocalMemoryState local_state;
+
+    //Everything above (and this struct) is allocated from here, except ROM and a mapped save.
+    //The rest of the machine (CoreState, the block cache) goes in after it, so this is the whole emulator's arena
+    Arena arena;
 } Memory;
 
-//Initialization
-Memory* memory_init(FILE* rom_file, FILE* boot_rom_file);
-MBC_Data* get_mbc_data(FILE* rom_file);
-uint8_t load_rom_data(Memory* mem, FILE* rom_file);
+//Initialization. system_size is extra arena space for the rest of the machine
+Memory* memory_init(FILE* rom_file, FILE* boot_rom_file, size_t system_size);
+uint8_t get_mbc_data(FILE* rom_file, MBC_Data* data); //Returns 0 for success, 1 for failure
 uint8_t load_save_data(Memory* mem);
 void save_save_data(Memory* mem);
+void save_update_trailer(Memory* mem); //Hands what the MBC keeps after EXRAM to the save file's flusher
+void get_save_path(Memory* mem, char* file_path);
 uint8_t load_boot_rom_data(Memory* mem, FILE* boot_rom_file);
 void get_game_name(Memory* mem);
 
@@ -13,19 +13,87 @@
 * Memory bus will help be an interface between memory reads/writes and the state of the rest of the system
 */
 
+/*
+* Page tables.
+* The address space is split into 256 byte pages, and each page has a host pointer for reads and one for writes.
+* If a page's pointer is there, the access is just that pointer plus the bottom byte of the address. If it's NULL,
+* the access goes the slow way through get_memory_value/mem_accessible like before.
+* Pages are only given a pointer if accessing them never has any side effects and is always allowed until the
+* mapping changes: ROM and WRAM/echo RAM, and EXRAM while it's enabled (except MBC2's, since it's only 4 bits wide,
+* and MBC3's RTC registers).
+* ROM pages are only readable, since writes there go to the MBC. VRAM and OAM depend on the PPU mode, and the last
+* two pages have IO in them, so those always go the slow way.
+* The tables get rebuilt whenever the mapping could change (MBC writes, boot ROM unmapping) and when DMA starts or
+* ends, since the CPU can only get to HRAM during DMA.
+*/
+#define MEMORY_PAGE_SIZE 0x100
+#define MEMORY_PAGE_COUNT 0x100
+
+/*
+* Access masks.
+* What the CPU can access only depends on the PPU mode, DMA and whether EXRAM is enabled, and those only change a few
+* times a scanline. So instead of working it out on every access, each accessor has a mask with a bit per memory
+* range, which gets redone whenever one of those changes (set_ppu_mode, DMA starting/ending, MBC writes).
+*/
+#define ACCESSOR_COUNT 3
+
+/*
+* Instruction fetch window.
+* Opcodes and immediates are almost always read one after another from the same page, so the bus also keeps the
+* page the last fetch came from. Fetches that land in that page skip even the table lookup, and anything else goes
+* through mem_read and moves the window to the new page (if that page is in the read table).
+*/
+
 typedef struct {
+	uint8_t* base; //Host pointer for the first address in the window
+	uint16_t start; //First address the window covers
+	uint16_t length; //Number of bytes covered, 0 if there's no window right now
+} FetchWindow;
+
+typedef struct MemoryBus {
 	GlobalSystemState* system_state; //Has a reference to the states of systems it needs
 	Memory* memory; //Reference to memory, which holds the actual memory values
+	struct BlockCache* block_cache; //Cached code that writes might need to invalidate. NULL if there isn't one
+	struct PPU* ppu; //PPU that has to catch up before anything touches video memory or LCD registers
+	struct APU* apu; //APU that has to catch up before anything touches the sound registers or wave RAM
+	FetchWindow fetch_window; //Page the CPU is currently fetching from
+
+	//Which memory ranges each accessor can get to right now. One bit per MemoryRange
+	uint8_t access_masks[ACCESSOR_COUNT];
+
+	uint8_t* read_pages[MEMORY_PAGE_COUNT]; //Host pointer for each page that can be read directly, NULL if it can't
+	uint8_t* write_pages[MEMORY_PAGE_COUNT]; //Same for writes
 } MemoryBus;
 
-MemoryBus* memory_bus_init(Memory* mem, GlobalSystemState* system_state);
-void memory_bus_destroy(MemoryBus* bus);
+MemoryBus* memory_bus_init(MemoryBus* bus, Memory* mem, GlobalSystemState* system_state);
 uint8_t mem_read(MemoryBus* bus, uint16_t address, Accessor accessor);
 uint8_t mem_write(MemoryBus* bus, uint16_t address, uint8_t new_val, Accessor accessor);
-void update_global_state(MemoryBus* bus, uint16_t address, uint8_t new_val);
 uint8_t get_input_byte(Memory* mem, uint8_t val);
 uint8_t mask_hw_reg_read(uint8_t val, uint16_t address);
 uint8_t mask_hw_reg_write(uint8_t new_val, uint8_t old_val, uint16_t address);
-uint8_t mem_accessible(MemoryBus* bus, MemoryRange range, Accessor accessor);
+uint8_t mem_fetch_slow(MemoryBus* bus, uint16_t address); //Fetch that misses the window. Moves the window if it can
+void memory_map_update(MemoryBus* bus); //Rebuilds the page tables (and access masks) from the current banks and DMA state
+void memory_access_update(MemoryBus* bus); //Redoes the access masks
+
+//Checks whether memory location is accessible based on memory range and who is accessing
+//Returns 0 for inaccesible, 1 for accessible
+static inline uint8_t mem_accessible(MemoryBus* bus, MemoryRange range, Accessor accessor) {
+	return (bus->access_masks[accessor] >> range) & 0x1;
+}
+
+//Reads a byte the CPU is fetching (opcode or immediate)
+static inline uint8_t mem_fetch(MemoryBus* bus, uint16_t address) {
+	uint16_t offset = address - bus->fetch_window.start;
+
+	if (offset < bus->fetch_window.length)
+		return bus->fetch_window.base[offset];
+
+	return mem_fetch_slow(bus, address);
+}
+
+//Drops the fetch window, so the next fetch goes through mem_read
+static inline void mem_fetch_invalidate(MemoryBus* bus) {
+	bus->fetch_window.length = 0;
+}
 
 #endif
\ No newline at end of file
@@ -1,8 +1,11 @@
+#ifndef MISC_INSTRUCTIONS_H
+#define MISC_INSTRUCTIONS_H
+
 #include "instructions.h"
 #include "interrupt_handler.h"
 
 //Complements accumulator register
-int cpl(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int cpl(CPU* cpu, Instruction* instruction) {
     //Gets current accumulator value
     uint8_t val = getRegisterValue8(cpu, REG_A);
 
@@ -18,7 +21,7 @@ int cpl(CPU* cpu, Instruction* instruction) {
 }
 
 //Complements carry flag
-int ccf(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ccf(CPU* cpu, Instruction* instruction) {
     //Update flags
     updateFlag(cpu, CARRY, !flagIsSet(cpu, CARRY)); //Sets flag if carry is clear, clears if its set
     clearFlag(cpu, SUB);
@@ -29,7 +32,7 @@ int ccf(CPU* cpu, Instruction* instruction) {
 }
 
 //Sets carry flag
-int scf(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int scf(CPU* cpu, Instruction* instruction) {
     //Update flags
     setFlag(cpu, CARRY);
     clearFlag(cpu, SUB);
@@ -40,7 +43,7 @@ int scf(CPU* cpu, Instruction* instruction) {
 }
 
 //Decimal adjust accumulator
-int daa(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int daa(CPU* cpu, Instruction* instruction) {
     /*
     * This instruction is WEIRD and is the only one to use the half-carry and sub flags
     * Basically it treats hex operations as if they are decimal, so instead of
@@ -88,7 +91,7 @@ int daa(CPU* cpu, Instruction* instruction) {
 }
 
 //Intended to stop the clock and put the system into a more efficient power saving mode
-int stop(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int stop(CPU* cpu, Instruction* instruction) {
     /*
     * This instruction is really weird and has a lot of strange edge cases.
     * On CGB, this instruction enables the double-speed mode. On GB, 
@@ -109,7 +112,7 @@ int stop(CPU* cpu, Instruction* instruction) {
 }
 
 //Halts the CPU but does not stop the clock
-int halt(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int halt(CPU* cpu, Instruction* instruction) {
     /*
     * This is also a very strange instruction.
     * Depending on the different interrupt flags, it either halts, does not halt,
@@ -138,13 +141,13 @@ int halt(CPU* cpu, Instruction* instruction) {
 }
 
 //No-operation. Simply acts as a dummy instruction
-int nop(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int nop(CPU* cpu, Instruction* instruction) {
     //0 extra t-cycles
     return 0;
 }
 
 //Disables interrupts immediately by clearing IME
-int di(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int di(CPU* cpu, Instruction* instruction) {
     //Clears IME flag
     clearFlag(cpu, IME);
     //Since EI has a 1 cycle delay to setting the IME, a second flag is used to track that.
@@ -156,10 +159,12 @@ int di(CPU* cpu, Instruction* instruction) {
 }
 
 //Enables interrupts with a 1-cycle delay by setting IME
-int ei(CPU* cpu, Instruction* instruction) {
+FORCE_INLINE int ei(CPU* cpu, Instruction* instruction) {
     //Set enable IME flag, which accounts for the 1-cycle delay
     setFlag(cpu, ENABLE_IME);
 
     //0 extra t-cycles
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
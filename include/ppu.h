@@ -46,6 +46,14 @@
 
 //This is the Pixel Processing Unit, which is the GameBoy's screen basically.
 
+/*
+* Catch-up PPU.
+* The PPU doesn't get ticked with the rest of the hardware. It only runs (ppu_catch_up) when something could see what
+* it's doing: the CPU or DMA touching VRAM, OAM or the LCD registers, the end of a frame, or a tick where it could
+* request an interrupt, which gets posted as EVENT_PPU. Then it does every tick it missed in one go.
+* Outside of modes 2 and 3 nothing happens between mode boundaries, so those ticks just get skipped.
+*/
+
 //Flags that are internal to the PPU
 typedef struct {
     uint16_t window_ly; //Window has an internal scanline counter 
@@ -78,37 +86,46 @@ typedef struct {
     uint32_t OBJ1_Palette[4];
 } PaletteData;
 
-typedef struct {
+typedef struct PPU {
     MemoryBus* bus; //Memory
     SDL_Display_Data* sdl_data;
 
     //Scanline OAM entires
     OAM_Entry scanline_obj[10]; //Each scanline can have at max 10 sprites visible
 
-    //Frame buffer and current palette data for drawing...
-    uint32_t* framebuffer; //Screen frame buffer
-    PaletteData* palette; //DMG palette consistes of 4 colors. Place holder for now.
-
     //PPU state flags
     LocalPPUState local_state;
     GlobalPPUState* global_state;
+
+    //Frame buffer and current palette data for drawing...
+    //Stored right in the struct (and last, since they're big and only get touched in mode 3) so copying the PPU copies them too
+    PaletteData palette; //DMG palette consistes of 4 colors. Place holder for now.
+    uint32_t framebuffer[160 * 144]; //Screen frame buffer. Gameboy is 160x144
 } PPU;
 
 //PPU functions
-PPU* ppu_init(MemoryBus* bus, GlobalPPUState* global_state, SDL_Display_Data* sdl_data);
-void ppu_destroy(PPU* ppu);
+PPU* ppu_init(PPU* ppu, MemoryBus* bus, GlobalPPUState* global_state, SDL_Display_Data* sdl_data);
 void update_ppu(PPU* ppu);
+void ppu_catch_up(PPU* ppu, uint64_t time); //Does every tick before time
+void ppu_event(PPU* ppu, uint64_t time); //Catches up through a tick that could request an interrupt
+void ppu_post_interrupt(PPU* ppu); //Reposts EVENT_PPU. Has to be redone whenever LCDC, STAT or LYC get written
 void draw(PPU* ppu);
 void ppu_oam_scan(PPU* ppu);
 void ppu_write_lcd(PPU* ppu);
 void update_stat(PPU* ppu);
 
+//How many upcoming ticks leave what the CPU can see from the PPU unchanged. Used for skipping idle time
+uint32_t ppu_ticks_until_change(PPU* ppu); //LY, STAT and the PPU's interrupts
+uint32_t ppu_ticks_until_ly_change(PPU* ppu); //Just LY
+void ppu_post_frame_end(Scheduler* scheduler, GlobalPPUState* ppu_state, uint64_t now);
+
 //PPU Mode switch functions
 void switch_mode_0_1(PPU* ppu);
 void switch_mode_1_2(PPU* ppu);
 void switch_mode_2_3(PPU* ppu);
 void switch_mode_3_0(PPU* ppu);
 void switch_mode_0_2(PPU* ppu);
+void set_ppu_mode(PPU* ppu, PPU_Mode mode);
 
 //Helper functions
 void update_ppu_state(PPU* ppu);
@@ -6,7 +6,8 @@
 
 typedef struct {
 	uint8_t lcd_on; //Whether LCD is on or not
-	uint32_t frame_time; //Current frame time
+	uint32_t frame_time; //Frame time of the next tick the PPU does
+	uint64_t synced_time; //PPU has done every tick before this one (see ppu_catch_up)
 	uint16_t frame_rate; //Current framerate
 	PPU_Mode current_mode;
 } GlobalPPUState;
@@ -0,0 +1,65 @@
+#ifndef RECOMP_H
+#define RECOMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fe_de_ex.h"
+#include "instructions.h"
+
+/*
+* Ahead of time recompiled blocks.
+* tools/recomp.c turns a ROM into a C file with one function per block it can find by following control
+* flow from the entry point and the RST/interrupt vectors. That file gets compiled into the emulator
+* (see RECOMP_SOURCE in CMakeLists.txt), and when the block cache decodes a ROM block that has a
+* recompiled version, it just calls that instead.
+*
+* Recompiled blocks do the exact same thing execute_block does for each instruction, so there's no
+* timing difference, there's just no decode or per instruction loop left at all.
+* Anything the tool can't see ahead of time (JP HL targets, code in RAM, banks it couldn't work out)
+* isn't in the file, so those blocks just run in the interpreter like normal.
+*/
+
+typedef void (*RecompBlockFn)(EmulatorSystem* system);
+
+//Single entry in the registry the tool generates. Sorted by bank then pc
+typedef struct {
+    uint16_t bank;
+    uint16_t pc;
+    RecompBlockFn function;
+} RecompBlock;
+
+//Generated by tools/recomp.c. Without a generated file linked in, recomp.c provides an empty registry
+extern const RecompBlock recomp_blocks[];
+extern const uint32_t recomp_num_blocks;
+extern const uint64_t recomp_rom_checksum; //rom_image_hash of the ROM the blocks were made from
+
+uint8_t recomp_matches_rom(Memory* mem); //Returns 1 if the linked in blocks were made from this ROM
+RecompBlockFn recomp_lookup(uint16_t bank, uint16_t pc); //Returns NULL if there isn't a recompiled block here
+
+//Helpers for the generated code
+
+//Function for the block at bank:pc
+#define RECOMP_BLOCK(bank, pc) static void recomp_block_##bank##_##pc(EmulatorSystem* system)
+#define RECOMP_BLOCK_NAME(bank, pc) recomp_block_##bank##_##pc
+
+#define RECOMP_BLOCK_START \
+    CPU* cpu = system->cpu; \
+    uint32_t generation = system->block_cache->generation; \
+    int extra_cycles; \
+    (void)generation;
+
+//One instruction, same steps as execute_block
+#define RECOMP_OP(fetch_length, cycles, handler) \
+    cpu->registers.pc += (fetch_length); \
+    tick_hardware(system, (cycles)); \
+    extra_cycles = handler(cpu); \
+    if (extra_cycles != 0) \
+        tick_hardware(system, extra_cycles);
+
+//Goes between instructions
+#define RECOMP_CHECK \
+    if (block_should_exit(system, generation)) \
+        return;
+
+#endif
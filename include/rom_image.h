@@ -0,0 +1,51 @@
+#ifndef ROM_IMAGE_H
+#define ROM_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+* ROM images.
+* The ROM is never written to, so instead of every emulator copying the whole thing into its own buffer,
+* the file just gets mapped read only. If the header says the ROM is bigger than the file, the mapping is
+* private with zeroes past the end of the file (same as the old calloc'd buffer had).
+* Images are kept in a registry keyed by the file's identity (device, inode, size and modification time), so
+* every emulator in the process running the same ROM file shares one mapping without having to read it first.
+* They're reference counted and unmapped when the last one lets go.
+* Anywhere mmap isn't available, it just falls back to reading the file into a buffer (which still gets shared,
+* by comparing contents since there's no file identity to go on there).
+*/
+
+typedef enum {
+    ROM_IMAGE_MAPPED, //Read only mapping of the file
+    ROM_IMAGE_PADDED, //Private mapping, file followed by zeroes up to the header size
+    ROM_IMAGE_BUFFER //Read into a malloc'd buffer
+} RomImageType;
+
+typedef struct RomImage {
+    const uint8_t* data;
+    size_t size; //Size from the header, which is at least the file size
+    size_t map_size; //How much actually got mapped/allocated
+    RomImageType type;
+    uint32_t references;
+
+    //File this came from, so the same file doesn't get loaded twice
+    uint8_t has_file_id; //0 if the file couldn't be stat'd
+    uint64_t file_device;
+    uint64_t file_inode;
+    uint64_t file_size;
+    int64_t file_mtime;
+
+    //FNV-1a of all size bytes. Only worked out the first time something asks for it (see rom_image_hash)
+    uint64_t hash;
+    uint8_t hash_valid;
+
+    struct RomImage* next; //Next image in the registry
+} RomImage;
+
+RomImage* rom_image_acquire(FILE* rom_file, size_t rom_size); //Returns NULL if the ROM couldn't be loaded
+void rom_image_release(RomImage* image);
+uint64_t rom_image_hash(RomImage* image); //64 bit FNV-1a of the whole image, hashed on first use
+
+#endif
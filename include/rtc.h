@@ -0,0 +1,50 @@
+#ifndef RTC_H
+#define RTC_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+* MBC3 real time clock.
+* The clock never gets ticked. Instead it keeps what the counter was at some point in emulated time, and
+* works out the current value from how many cycles have gone by since then whenever something actually
+* looks at it (latching, writing a register, saving). So it doesn't cost anything per cycle, even with
+* fast forward on. Emulated time is used instead of the host clock while running, so the clock stays in
+* step with the game when it's sped up. While the emulator is closed, the save file's timestamp is used
+* to move the clock forward by however long it's been on the host clock.
+*/
+
+#define RTC_CYCLES_PER_SECOND 4194304 //Single speed T-cycles
+#define RTC_SECONDS_PER_DAY 86400
+#define RTC_MAX_DAYS 512 //9 bit day counter
+#define RTC_REGISTER_COUNT 5
+#define RTC_SAVE_SIZE 48 //Same layout as the trailer other emulators put on MBC3 saves
+
+//RTC register select values
+typedef enum {
+    RTC_SECONDS = 0x08,
+    RTC_MINUTES = 0x09,
+    RTC_HOURS = 0x0A,
+    RTC_DAY_LOW = 0x0B,
+    RTC_DAY_HIGH = 0x0C //Bit 0 is day bit 8, bit 6 is halt, bit 7 is day carry
+} RTC_Register;
+
+typedef struct {
+    const uint64_t* cycle_source; //Emulated cycle counter to measure time with. NULL if there isn't one yet
+    uint64_t base_cycle; //Value of the cycle counter when the clock was last set
+    uint64_t base_value; //Clock value in cycles at base_cycle (seconds * RTC_CYCLES_PER_SECOND, days included)
+    uint8_t halted;
+    uint8_t day_carry;
+
+    uint8_t latched[RTC_REGISTER_COUNT]; //What the CPU reads, in register select order
+    uint8_t latch_value; //Last value written to the latch register. Latches on a 0 then 1
+} RTC;
+
+void rtc_init(RTC* rtc);
+void rtc_set_clock(RTC* rtc, const uint64_t* cycle_source);
+void rtc_latch_write(RTC* rtc, uint8_t value);
+void rtc_write(RTC* rtc, RTC_Register reg, uint8_t value);
+uint8_t rtc_load(RTC* rtc, FILE* save_file); //Returns 0 for success, 1 for failure
+void rtc_save(RTC* rtc, uint8_t* data); //Fills in RTC_SAVE_SIZE bytes
+
+#endif
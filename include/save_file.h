@@ -0,0 +1,34 @@
+#ifndef SAVE_FILE_H
+#define SAVE_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+* Battery backed save files.
+* EXRAM for battery backed cartridges is a shared mapping of the start of the .sav file, so every write
+* the game makes goes straight into the file's pages, with no extra work on the emulation thread.
+* The OS already tracks which of those pages are dirty, so a flusher thread just msyncs the mapping every
+* so often to get them onto the disk. If the emulator crashes, nothing the game saved gets lost.
+* Anything the MBC stores after EXRAM (the RTC) gets handed over with save_file_set_trailer, and the flusher
+* writes it past the end of the mapping along with everything else.
+*
+* The file gets an exclusive lock while it's mapped, so two emulators running the same game can't both write
+* into it. The second one gets in_use back and keeps its EXRAM to itself instead.
+* Anywhere mmap isn't available, save_file_open fails and EXRAM goes back to being saved on close.
+*/
+
+#define SAVE_FLUSH_INTERVAL_DEFAULT 5000 //Milliseconds between flushes
+#define SAVE_TRAILER_MAX 64 //Most bytes that can go after EXRAM
+
+typedef struct SaveFile SaveFile;
+
+//Returns NULL if the file can't be mapped. in_use gets set if that's because something else has it locked
+SaveFile* save_file_open(const char* path, size_t size, uint8_t* in_use);
+void save_file_close(SaveFile* save); //Flushes everything and unmaps it
+uint8_t* save_file_data(SaveFile* save);
+void save_file_flush(SaveFile* save); //Blocks until everything's on disk
+void save_file_set_trailer(SaveFile* save, const uint8_t* data, size_t size); //Gets written on the next flush
+uint8_t save_file_start_flusher(SaveFile* save, uint32_t interval_ms); //Returns 0 if the thread started
+
+#endif
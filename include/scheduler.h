@@ -0,0 +1,52 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+* Hardware event scheduler.
+* Hardware that only does something at specific times (the timer interrupt, DMA, the APU frame sequencer, frame end,
+* PPU interrupts, audio samples) posts when that is going to be, in emulated cycles (timer_state.elapsed_time), instead
+* of getting checked on every tick. Nothing else gets ticked, so tick_hardware just moves the time straight to the
+* earliest one and runs everything that's due.
+*
+* Each kind of event can only be pending once, so posting it again just moves it. The pending ones are kept in a
+* min-heap by time. Events due on the same tick run in the order they're listed here, which is the same order the
+* hardware used to get updated in.
+*/
+
+#define SCHEDULER_NEVER UINT64_MAX //Time of an event that isn't pending
+
+typedef enum {
+    EVENT_TIMER, //TIMA gets reloaded after an overflow and the timer interrupt gets requested
+    EVENT_DMA, //Next OAM DMA byte (for sources that go byte by byte) or the end of the transfer
+    EVENT_APU_FRAME_SEQUENCER, //DIV-APU ticks
+    EVENT_FRAME_END, //SDL gets polled
+    EVENT_PPU, //PPU catches up to a tick it could request an interrupt on
+    EVENT_APU_SAMPLE, //APU catches up and puts the next sample in the audio buffer
+    EVENT_COUNT
+} EventType;
+
+typedef struct Scheduler {
+    uint64_t times[EVENT_COUNT]; //When each event is due
+    uint8_t heap[EVENT_COUNT]; //Pending events, soonest first
+    uint8_t heap_index[EVENT_COUNT]; //Where each pending event is in the heap
+    uint8_t count; //Number of pending events
+} Scheduler;
+
+void scheduler_init(Scheduler* scheduler);
+void scheduler_post(Scheduler* scheduler, EventType event, uint64_t time); //Posts or moves an event
+void scheduler_cancel(Scheduler* scheduler, EventType event);
+EventType scheduler_pop(Scheduler* scheduler); //Takes the soonest event out. There has to be one
+
+//Time of the soonest event
+static inline uint64_t scheduler_next_time(const Scheduler* scheduler) {
+    return (scheduler->count != 0) ? scheduler->times[scheduler->heap[0]] : SCHEDULER_NEVER;
+}
+
+//Time a specific event is due
+static inline uint64_t scheduler_event_time(const Scheduler* scheduler, EventType event) {
+    return scheduler->times[event];
+}
+
+#endif
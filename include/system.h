@@ -7,6 +7,8 @@
 #include "ppu.h"
 #include "master_clock.h"
 #include "apu.h"
+#include "block_cache.h"
+#include "core_state.h"
 
 //Holds global system information, including system time and pointers to individual pieces
 //The point of this is to have like a "central" struct
@@ -18,7 +20,7 @@
 //Soo basically the individual pieces are responsible for their own state, but this will
 //update them in relation to the emulator state as a whole, if that makes sense... Again I'm mostly thinking of timing.
 
-typedef struct {
+typedef struct EmulatorSystem {
     //SDL Data reference
     SDL_Data* sdl_data;
 
@@ -26,6 +28,9 @@ typedef struct {
     MemoryBus* bus;
     Memory* memory;
 
+    //Everything below (up to the block cache) points into here
+    CoreState* core;
+
     //System states
     GlobalSystemState* system_state;
 
@@ -34,6 +39,16 @@ typedef struct {
     PPU* ppu;
     APU* apu;
     MasterClock* sys_clock;
+
+    //Decoded block cache. NULL when built without BLOCK_CACHE
+    BlockCache* block_cache;
+
+    //JIT, only created when it's turned on with --jit
+    struct JIT* jit;
+
+    //Stops the emulator after this many frames (0 means run until closed). Used for benchmarking
+    uint32_t frame_limit;
+    uint32_t frames_run;
 } EmulatorSystem;
 
 //Initializes system.
@@ -42,6 +57,12 @@ typedef struct {
 EmulatorSystem* system_init(FILE* rom_file, FILE* boot_rom_file, SDL_Data* sdl_data);
 void system_destroy(EmulatorSystem* system);
 void tick_hardware(EmulatorSystem* system, uint16_t ticks); //Updates hardware timing
-void update_dma_transfer(EmulatorSystem* system);
+void run_events(EmulatorSystem* system); //Runs whatever's on the scheduler for the current tick
+
+//Whole machine snapshots. Everything but ROM is in the memory arena (plus a mapped save), so it's just a copy of that.
+//Snapshots only go back into the system they came from
+size_t system_snapshot_size(EmulatorSystem* system);
+void system_save_snapshot(EmulatorSystem* system, uint8_t* data);
+void system_load_snapshot(EmulatorSystem* system, const uint8_t* data);
 
 #endif 
\ No newline at end of file
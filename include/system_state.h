@@ -5,17 +5,19 @@
 #include "apu_state.h"
 #include "dma_state.h"
 #include "timer_state.h"
+#include "scheduler.h"
 
 typedef struct {
 	GlobalPPUState* ppu_state;
 	GlobalAPUState* apu_state;
 	GlobalDMAState* dma_state;
 	GlobalTimerState* timer_state;
+	Scheduler* scheduler; //Upcoming hardware events
 
 	uint8_t running; //Whether or not the emulator system is currently running or not
 } GlobalSystemState;
 
-GlobalSystemState* system_state_init();
-void system_state_destroy(GlobalSystemState* state);
+GlobalSystemState* system_state_init(GlobalSystemState* system_state, GlobalPPUState* ppu_state, GlobalAPUState* apu_state,
+	GlobalDMAState* dma_state, GlobalTimerState* timer_state, Scheduler* scheduler);
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -4,10 +4,15 @@
 #include <stdint.h>
 
 //This holds state data for the system timer and also the timer registers, as they are connected
+//The timer registers only get brought up to date when something reads or writes them (see master_clock.h)
 
 typedef struct {
 	uint64_t elapsed_time; //Elapsed time the emulator has been running. This never gets reset
-	uint16_t system_time; //System timer (~4MHz)
+	uint64_t div_reset_time; //Elapsed time DIV was last written. System time (~4MHz) is the ticks since then
+	uint64_t synced_time; //DIV and TIMA are up to date for every tick before this one
+
+	uint8_t prev_tac_bit; //What the TAC bit of the system time was on the last synced tick
+	uint8_t tima_overflow; //TIMA overflowed on the last synced tick, so the next one reloads it
 } GlobalTimerState;
 
 #endif
\ No newline at end of file
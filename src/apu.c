@@ -2,6 +2,18 @@
 #include "logging.h"
 #include <stdlib.h>
 
+//Helper functions
+static uint32_t ticks_until_sample(LocalAPUState* state);
+static uint8_t apu_flags_pending(APU* apu);
+static void apu_skip(APU* apu, uint64_t start, uint64_t end);
+static void skip_period_div(uint16_t* period_div, uint16_t period_start, uint8_t* sample_num, uint8_t samples,
+	uint64_t time_start, uint8_t dots, uint64_t start, uint64_t end);
+static uint8_t pulse_out(APU* apu, uint8_t nrx1, uint8_t sample_num, uint8_t high_vol);
+static uint8_t ch3_wave_out(APU* apu);
+static uint32_t ch4_dots_to_wait(APU* apu);
+static void init_lfsr_jumps(APU* apu);
+static uint16_t apply_lfsr_jump(const LFSRJump* jump, uint16_t lfsr);
+
 /*
 * The GameBoy's APU is what controls the sounds that come frome the speaker.
 * This is full of quite a few tricky details and a lot of timing to keep up with.
@@ -15,11 +27,10 @@
 * which effectively increases the frequency the faster you go through them, which decreases the period.
 */
 
-APU* apu_init(MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_data) {
-	APU* apu = (APU*)calloc(1, sizeof(APU));
-
+//APU lives in the core state, which starts out zeroed, so only the non-zero values get set here
+APU* apu_init(APU* apu, MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_data) {
 	if (bus == NULL || global_state == NULL || apu == NULL) {
-		printError("Error initializing APU");
+		log_message(LOG_LEVEL_ERROR, "Error initializing APU");
 		return NULL;
 	}
 
@@ -33,8 +44,7 @@ APU* apu_init(MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_
 	apu->local_state.ch3.length_timer_end = 256;
 	apu->local_state.ch4.length_timer_end = 64;
 
-	apu->local_state.div_bit = 4; //Is 5 in double speed mode
-	apu->local_state.prev_div_state = 0;
+	apu->local_state.apu_div_time = SCHEDULER_NEVER; //Hasn't gone up yet
 	apu->local_state.target_interval = 4194304.0 / 44100.0; //GB clock speed divided by sample rate gives number of cycles between samples
 	apu->local_state.error_accumulator = 0.0;
 
@@ -57,12 +67,18 @@ APU* apu_init(MemoryBus* bus, GlobalAPUState* global_state, SDL_Audio_Data* sdl_
 	for (int i = 0; i < 32; ++i)
 		apu->duty_cycles[i] = duty_cycles[i];
 
-	return apu;
-}
+	init_lfsr_jumps(apu);
+
+	//System time starts at 0, so the first falling edge is a whole period in
+	scheduler_post(bus->system_state->scheduler, EVENT_APU_FRAME_SEQUENCER, APU_DIV_PERIOD);
+
+	//Tick 0 is the first one counted towards the first sample
+	scheduler_post(bus->system_state->scheduler, EVENT_APU_SAMPLE, ticks_until_sample(&apu->local_state) - 1);
+
+	//Sound registers have to catch the APU up before they get touched
+	bus->apu = apu;
 
-void apu_destroy(APU* apu) {
-	if (apu != NULL)
-		free(apu);
+	return apu;
 }
 
 //Adds to SDL audio buffer
@@ -151,20 +167,157 @@ APUSample mix_dac_values(APU* apu) {
 	return sample;
 }
 
-//Checks whether channels should be activated and updates DIV APU
-void update_apu(APU* apu, uint64_t emulator_time) {
-	//Every 95.2 t-cycles on average, fill audio buffer. This is approximately 44.1kHz
-	//Accumulating error for each t-cycle will allow any extra cycles to be accounted for, so this should
-	//average approximately 95.2 t-cycles per sample, which is approximately 44.1kHz with GB's clock speed
-	apu->local_state.error_accumulator += 1.0; //Increment error accumulator
-	if (apu->local_state.error_accumulator >= apu->local_state.target_interval) {
-		apu->local_state.error_accumulator -= apu->local_state.target_interval;
-		fill_buffer(apu);
+//Every 95.2 t-cycles on average, fill audio buffer. This is approximately 44.1kHz
+//Accumulating error for each t-cycle will allow any extra cycles to be accounted for, so this should
+//average approximately 95.2 t-cycles per sample, which is approximately 44.1kHz with GB's clock speed
+static uint32_t ticks_until_sample(LocalAPUState* state) {
+	uint32_t ticks = 0;
+
+	do {
+		state->error_accumulator += 1.0; //Increment error accumulator
+		++ticks;
+	} while (state->error_accumulator < state->target_interval);
+
+	return ticks;
+}
+
+//Samples go in before the APU does the tick they're on, so it only has to catch up to right before it
+void apu_sample_event(APU* apu, uint64_t time) {
+	apu_catch_up(apu, time);
+
+	apu->local_state.error_accumulator -= apu->local_state.target_interval;
+	fill_buffer(apu);
+
+	scheduler_post(apu->bus->system_state->scheduler, EVENT_APU_SAMPLE, time + ticks_until_sample(&apu->local_state));
+}
+
+//Does every tick the APU hasn't done yet before time
+void apu_catch_up(APU* apu, uint64_t time) {
+	LocalAPUState* state = &apu->local_state;
+
+	while (state->synced_time < time) {
+		//Triggers, turning the APU off and DIV-APU going up need the whole tick
+		if (state->synced_time == state->apu_div_time || apu_flags_pending(apu)) {
+			update_apu(apu, state->synced_time);
+			++state->synced_time;
+			continue;
+		}
+
+		//Nothing else can happen until the next DIV-APU tick, so everything up to it gets skipped in one go
+		uint64_t end = time;
+		if (state->apu_div_time > state->synced_time && state->apu_div_time < end)
+			end = state->apu_div_time;
+
+		apu_skip(apu, state->synced_time, end);
+		state->synced_time = end;
+	}
+}
+
+//Whether the next tick has a trigger or turning the APU off to deal with
+//Channel 4 stays triggered while the APU is off, but it doesn't do anything until it gets turned back on
+static uint8_t apu_flags_pending(APU* apu) {
+	GlobalAPUState* global_state = apu->global_state;
+
+	return global_state->trigger_ch1 || global_state->trigger_ch2 || global_state->trigger_ch3 ||
+		(global_state->trigger_ch4 && global_state->apu_enable == 1) || global_state->turn_off_apu;
+}
+
+//Does the ticks from start to end, which can't have a trigger or a DIV-APU tick in them
+//The registers can't change in between, so only the period dividers and the LFSR move, and only the last tick's output matters
+static void apu_skip(APU* apu, uint64_t start, uint64_t end) {
+	LocalAPUState* state = &apu->local_state;
+	state->apu_div_updated = 0;
+
+	update_dacs(apu);
+	if (!apu->global_state->apu_enable)
+		return;
+
+	if (state->ch1.dac_enable) {
+		if (state->ch1.enable == 0)
+			state->ch1.out = 0;
+		else {
+			skip_period_div(&state->ch1.period_div, state->ch1.period_start, &state->ch1.sample_num, 8,
+				state->ch1.emulator_time_start, 4, start, end);
+			state->ch1.out = pulse_out(apu, apu->bus->memory->NR11_LOCATION, state->ch1.sample_num, state->ch1.high_vol);
+		}
+	}
+
+	if (state->ch2.dac_enable) {
+		if (state->ch2.enable == 0)
+			state->ch2.out = 0;
+		else {
+			skip_period_div(&state->ch2.period_div, state->ch2.period_start, &state->ch2.sample_num, 8,
+				state->ch2.emulator_time_start, 4, start, end);
+			state->ch2.out = pulse_out(apu, apu->bus->memory->NR21_LOCATION, state->ch2.sample_num, state->ch2.high_vol);
+		}
+	}
+
+	if (state->ch3.dac_enable) {
+		Ch3State* ch3 = &state->ch3;
+
+		if (ch3->enable == 0)
+			ch3->out = 0;
+		else {
+			//Output is a tick behind, so the second to last tick's sample is what comes out
+			if (end - start > 1) {
+				skip_period_div(&ch3->period_div, ch3->period_start, &ch3->sample_num, 32, ch3->emulator_time_start, 2, start, end - 1);
+				ch3->last_sample = ch3_wave_out(apu);
+			}
+
+			skip_period_div(&ch3->period_div, ch3->period_start, &ch3->sample_num, 32, ch3->emulator_time_start, 2, end - 1, end);
+			ch3->out = ch3->last_sample;
+			ch3->last_sample = ch3_wave_out(apu);
+		}
+	}
+
+	if (state->ch4.dac_enable && state->ch4.enable) {
+		Ch4State* ch4 = &state->ch4;
+		uint64_t dots = ch4_dots_to_wait(apu);
+		uint64_t next = ch4->last_lfsr_clock + dots; //First tick the LFSR can get clocked on
+
+		if (next < start)
+			next = start;
+		if (dots == 0)
+			dots = 1; //Gets clocked every tick
+
+		//Every clock from next to end happens at once
+		if (next < end) {
+			uint64_t clocks = (end - 1 - next) / dots + 1;
+			uint8_t mode = (apu->bus->memory->NR43_LOCATION >> 0x3) & 0x1;
+
+			ch4->last_lfsr_clock = next + (clocks - 1) * dots;
+			ch4->lfsr = lfsr_jump(apu, ch4->lfsr, mode, clocks);
+		}
+
+		ch4->out = (ch4->lfsr & 0x1) ? ch4->high_vol : 0;
 	}
+}
+
+//Period div ticks every however many dots since the channel was triggered (time_start), and every overflow
+//moves on to the next sample. This does all of those from start to end at once
+static void skip_period_div(uint16_t* period_div, uint16_t period_start, uint8_t* sample_num, uint8_t samples,
+	uint64_t time_start, uint8_t dots, uint64_t start, uint64_t end) {
+	uint64_t clocks = (end - time_start + dots - 1) / dots - (start - time_start + dots - 1) / dots;
+	uint64_t to_overflow = 0x800 - *period_div;
+
+	if (clocks < to_overflow) {
+		*period_div += (uint16_t)clocks;
+		return;
+	}
+
+	//After the first overflow it goes back to period start every time
+	clocks -= to_overflow;
+	uint64_t period = 0x800 - period_start;
 
-	//Update DIV APU for channel updates
-	//This happens even when APU is off, as it is tied to DIV
-	update_div_apu(apu);
+	*period_div = period_start + (uint16_t)(clocks % period);
+	*sample_num = (uint8_t)((*sample_num + 1 + clocks / period) % samples);
+}
+
+//Checks whether channels should be activated and updates DIV APU
+void update_apu(APU* apu, uint64_t emulator_time) {
+	//DIV APU gets updated by its event, even when APU is off, as it is tied to DIV
+	//Channels only need to know whether it went up this tick
+	apu->local_state.apu_div_updated = apu->local_state.apu_div_time == emulator_time;
 
 	//Update DACs to see which channels should be updated
 	update_dacs(apu);
@@ -240,20 +393,25 @@ void update_dacs(APU* apu) {
 }
 
 //Update DIV APU
-void update_div_apu(APU* apu) {
-	uint8_t current_div_bit = (apu->bus->memory->DIV_LOCATION >> apu->local_state.div_bit) & 0x1; //Bit 4/5 of DIV
+//DIV bit went from 1 to 0, so increment APU DIV. The next time is a whole period later unless DIV gets written
+void apu_div_event(APU* apu, uint64_t time) {
+	apu_catch_up(apu, time); //Ticks before this one still need to see the old DIV-APU
 
-	//If previos bit was 1 and new bit is 0, an update occurs, so increment APU DIV
-	if (apu->local_state.prev_div_state == 1 && current_div_bit == 0) {
-		++apu->local_state.apu_div;
-		apu->local_state.apu_div_updated = 1;
-	}
-	else
-		apu->local_state.apu_div_updated = 0;
+	++apu->local_state.apu_div;
+	apu->local_state.apu_div_time = time;
 
-	
-	//Replace previous bit with new bit
-	apu->local_state.prev_div_state = current_div_bit;
+	scheduler_post(apu->bus->system_state->scheduler, EVENT_APU_FRAME_SEQUENCER, time + APU_DIV_PERIOD);
+}
+
+//Writing DIV resets the system time, so if the bit was 1 on the last tick, it goes to 0 on the next one
+//If the system time was already going to be 0, nothing changes (it either wrapped or DIV was already written)
+void apu_div_reset(Scheduler* scheduler, uint64_t now, uint16_t system_time) {
+	if (system_time == 0)
+		return;
+
+	uint8_t last_bit = ((system_time - 1) >> APU_DIV_SYSTEM_BIT) & 0x1; //Bit on the last tick
+
+	scheduler_post(scheduler, EVENT_APU_FRAME_SEQUENCER, last_bit ? now : now + APU_DIV_PERIOD);
 }
 
 //Checks whether each channel has been triggered
@@ -547,14 +705,8 @@ void update_ch1(APU* apu, uint64_t emulator_time) {
 		}
 	}
 
-	//Finally, check duty cycle to see if output is high or low. This is bits 6 and 7 of NR11
-	uint8_t wave_duty = (apu->bus->memory->NR11_LOCATION >> 6) & 0x3;
-
-	//Set DAC output based on duty cycle
-	if (apu->duty_cycles[(8 * wave_duty) + ch1->sample_num] == 1)
-		ch1->out = ch1->high_vol;
-	else
-		ch1->out = 0;
+	//Finally, check duty cycle to see if output is high or low
+	ch1->out = pulse_out(apu, apu->bus->memory->NR11_LOCATION, ch1->sample_num, ch1->high_vol);
 }
 
 //Updates channel 2 values based on timing
@@ -610,14 +762,19 @@ void update_ch2(APU* apu, uint64_t emulator_time) {
 		}
 	}
 
-	//Finally, check duty cycle to see if output is high or low. This is bits 6 and 7 of NR11
-	uint8_t wave_duty = (apu->bus->memory->NR21_LOCATION >> 6) & 0x3;
+	//Finally, check duty cycle to see if output is high or low
+	ch2->out = pulse_out(apu, apu->bus->memory->NR21_LOCATION, ch2->sample_num, ch2->high_vol);
+}
+
+//Pulse channel output for the current sample. Duty cycle is bits 6 and 7 of NRx1
+static uint8_t pulse_out(APU* apu, uint8_t nrx1, uint8_t sample_num, uint8_t high_vol) {
+	uint8_t wave_duty = (nrx1 >> 6) & 0x3;
 
 	//Set DAC output based on duty cycle
-	if (apu->duty_cycles[(8 * wave_duty) + ch2->sample_num] == 1)
-		ch2->out = ch2->high_vol, 15;
+	if (apu->duty_cycles[(8 * wave_duty) + sample_num] == 1)
+		return high_vol;
 	else
-		ch2->out = 0;
+		return 0;
 }
 
 //Updates channel 3 values based on timing
@@ -660,6 +817,14 @@ void update_ch3(APU* apu, uint64_t emulator_time) {
 	}
 
 	//Finally, read wave RAM for wave amplitude
+	ch3->out = ch3->last_sample; //Output is whatever last sample was. This gets reset when APU is turned on
+	ch3->last_sample = ch3_wave_out(apu); //Update sample
+}
+
+//Wave amplitude of channel 3's current sample
+static uint8_t ch3_wave_out(APU* apu) {
+	Ch3State* ch3 = &apu->local_state.ch3;
+
 	//Wave RAM is 16 registers. Sample 0 upper nibble, sample 1 is lower nibble, etc
 	uint8_t wave_ram_offset = ch3->sample_num / 2;
 	uint8_t wave_ram_value = apu->bus->memory->io[0x30 + wave_ram_offset]; //Gets wave ram byte
@@ -680,9 +845,8 @@ void update_ch3(APU* apu, uint64_t emulator_time) {
 		out_val = out_val >> 1; //value of 2 gives 50% volume
 	if (out_vol == 3)
 		out_val = out_val >> 2; //Value of 3 gives 25% volume
-	
-	ch3->out = ch3->last_sample; //Output is whatever last sample was. This gets reset when APU is turned on
-	ch3->last_sample = out_val; //Update sample
+
+	return out_val;
 }
 
 //Updates channel 4 values based on timing
@@ -727,19 +891,8 @@ void update_ch4(APU* apu, uint64_t emulator_time) {
 		}
 	}
 
-	//Calculate how many dots need to pass before next LSFR clock
-	//This gets clocked every 16*x dots where x is clock_div<<shift. If clock_div = 0, its treated as 0.5 instead
-	uint32_t clock_div = apu->bus->memory->NR43_LOCATION & 0x07; //Bottom 3 bits are clock div
-	uint32_t clock_shift = (apu->bus->memory->NR43_LOCATION >> 4) & 0xF; //Upper nibble is shift frequency
-	uint32_t dots_to_wait;
-
-	if (clock_div != 0)
-		dots_to_wait = 16 * (clock_div << clock_shift);
-	else
-		dots_to_wait = 16 * ((1 << clock_shift)/2);
-
-	//If that amount has passed, then clock LSFR
-	if (emulator_time - ch4->last_lfsr_clock >= dots_to_wait) {
+	//If enough dots have passed, then clock LSFR
+	if (emulator_time - ch4->last_lfsr_clock >= ch4_dots_to_wait(apu)) {
 		ch4->last_lfsr_clock = emulator_time;
 		clock_lsfr(apu);
 	}
@@ -751,13 +904,27 @@ void update_ch4(APU* apu, uint64_t emulator_time) {
 		ch4->out = 0;
 }
 
+//Calculate how many dots need to pass before next LSFR clock
+//This gets clocked every 16*x dots where x is clock_div<<shift. If clock_div = 0, its treated as 0.5 instead
+static uint32_t ch4_dots_to_wait(APU* apu) {
+	uint32_t clock_div = apu->bus->memory->NR43_LOCATION & 0x07; //Bottom 3 bits are clock div
+	uint32_t clock_shift = (apu->bus->memory->NR43_LOCATION >> 4) & 0xF; //Upper nibble is shift frequency
+
+	if (clock_div != 0)
+		return 16 * (clock_div << clock_shift);
+	else
+		return 16 * ((1 << clock_shift)/2);
+}
+
 void clock_lsfr(APU* apu) {
-	uint16_t lfsr = apu->local_state.ch4.lfsr;
-	
 	//In 15 bit mode, this gets written to bit 15.
 	//In 7 bit mode, it gets written to both bit 15 and 7
 	uint8_t mode = (apu->bus->memory->NR43_LOCATION >> 0x3) & 0x1; //Bit 3 of NR43 controls this
 
+	apu->local_state.ch4.lfsr = lfsr_step(apu->local_state.ch4.lfsr, mode);
+}
+
+uint16_t lfsr_step(uint16_t lfsr, uint8_t mode) {
 	//If LSFR bits 0 and 1 are equal, write a 1 to bit 7/15, otherwise write 0
 	if ((lfsr & 0x1) == ((lfsr & 0x2) >> 1)) {
 		if (mode == 0)
@@ -773,8 +940,44 @@ void clock_lsfr(APU* apu) {
 	}
 
 	//Finally, LFSR gets shifted right
-	lfsr = lfsr >> 1;
+	return lfsr >> 1;
+}
+
+//Works out the jump for one clock straight from lfsr_step, then each bigger one is the one before it done twice
+static void init_lfsr_jumps(APU* apu) {
+	for (uint8_t mode = 0; mode < 2; ++mode) {
+		LFSRJump* jumps = apu->lfsr_jumps[mode];
+
+		jumps[0].constant = lfsr_step(0, mode);
+		for (int i = 0; i < 16; ++i)
+			jumps[0].bits[i] = lfsr_step((uint16_t)(1 << i), mode) ^ jumps[0].constant;
+
+		for (int n = 1; n < LFSR_JUMP_POWERS; ++n) {
+			const LFSRJump* half = &jumps[n - 1];
+
+			jumps[n].constant = apply_lfsr_jump(half, half->constant);
+			for (int i = 0; i < 16; ++i)
+				jumps[n].bits[i] = apply_lfsr_jump(half, half->bits[i]) ^ half->constant;
+		}
+	}
+}
+
+static uint16_t apply_lfsr_jump(const LFSRJump* jump, uint16_t lfsr) {
+	uint16_t out = jump->constant;
+
+	for (int i = 0; lfsr != 0; ++i, lfsr >>= 1) {
+		if (lfsr & 0x1)
+			out ^= jump->bits[i];
+	}
+
+	return out;
+}
+
+uint16_t lfsr_jump(APU* apu, uint16_t lfsr, uint8_t mode, uint64_t clocks) {
+	for (int n = 0; clocks != 0; ++n, clocks >>= 1) {
+		if (clocks & 0x1)
+			lfsr = apply_lfsr_jump(&apu->lfsr_jumps[mode][n], lfsr);
+	}
 
-	//Write back LFSR
-	apu->local_state.ch4.lfsr = lfsr;
-}
\ No newline at end of file
+	return lfsr;
+}
\ No newline at end of file
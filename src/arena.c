@@ -0,0 +1,37 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+uint8_t arena_init(Arena* arena, size_t size) {
+    arena->base = (uint8_t*)calloc(size, 1);
+    arena->size = size;
+    arena->used = 0;
+
+    return arena->base == NULL;
+}
+
+//Carves the next bit out of the arena. Alignment has to be a power of 2
+//Everything comes out zeroed, since the whole block was calloc'd
+void* arena_alloc(Arena* arena, size_t size, size_t alignment) {
+    if (arena->base == NULL)
+        return NULL;
+
+    uintptr_t start = (uintptr_t)(arena->base + arena->used);
+    uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    size_t offset = arena->used + (size_t)(aligned - start);
+
+    if (offset + size > arena->size)
+        return NULL;
+
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+void arena_destroy(Arena* arena) {
+    if (arena->base != NULL)
+        free(arena->base);
+
+    arena->base = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
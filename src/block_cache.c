@@ -0,0 +1,240 @@
+#include "block_cache.h"
+#include "logging.h"
+#include "recomp.h"
+#include "fusion.h"
+#include "idle_loop.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+BlockCache* block_cache_init(Memory* mem) {
+    if (mem == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error initializing block cache");
+        return NULL;
+    }
+
+    //Lives in the Memory arena, so restoring a snapshot puts it back in line with the RAM code it covers
+    BlockCache* cache = (BlockCache*)arena_alloc(&mem->arena, sizeof(BlockCache), ARENA_ALIGNMENT);
+    CachedBlock* blocks = (CachedBlock*)arena_alloc(&mem->arena, BLOCK_CACHE_SIZE * sizeof(CachedBlock), ARENA_ALIGNMENT);
+
+    if (cache == NULL || blocks == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error initializing block cache");
+        return NULL;
+    }
+
+    cache->memory = mem;
+    cache->blocks = blocks;
+
+    return cache;
+}
+
+//Instructions that change the pc (or stop the CPU) end a block
+static uint8_t ends_block(uint8_t opcode) {
+    switch (opcode) {
+        //JR
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+        //JP
+        case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9:
+        //CALL
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+        //RET/RETI
+        case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9:
+        //RST
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+        //HALT/STOP
+        case 0x76: case 0x10:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+//Works out which bank the code at pc is in, and where the memory area it's in ends
+//Returns 0 if code at pc can't be cached
+static uint8_t get_block_bank(Memory* mem, uint16_t pc, uint16_t* bank, uint32_t* area_end) {
+    //Boot ROM
+    if (mem->local_state.boot_rom_mapped && mem->boot_rom != NULL && pc < mem->boot_rom_size) {
+        *bank = BLOCK_BANK_BOOT;
+        *area_end = mem->boot_rom_size;
+    }
+    //Bank 0, which is only ever not bank 0 on MBC1 in mode 1 (same as get_rom_ptr)
+    else if (pc < 0x4000) {
+        *bank = 0;
+        if (mem->mbc_chip->mbc_type == MBC_1 && mem->mbc_chip->mbc_mode == 1)
+            *bank = mem->mbc_chip->current_rom_bank & ~0x9F;
+        *area_end = 0x4000;
+    }
+    //Switchable bank
+    else if (pc < 0x8000) {
+        *bank = mem->mbc_chip->current_rom_bank;
+        *area_end = 0x8000;
+    }
+    //WRAM. Echo RAM isn't cached since nothing really runs code from there
+    else if (pc >= 0xC000 && pc < 0xE000) {
+        *bank = 0;
+        *area_end = 0xE000;
+    }
+    //HRAM, not including IE
+    else if (pc >= 0xFF80 && pc < 0xFFFF) {
+        *bank = 0;
+        *area_end = 0xFFFF;
+    }
+    else
+        return 0;
+
+    return 1;
+}
+
+//Reads a byte for decoding without any of the side effects or access checks of mem_read
+static uint8_t peek(Memory* mem, uint16_t address) {
+    return *get_memory_value(mem, address).mem_ptr;
+}
+
+//Marks the RAM bytes a block covers
+static void mark_ram_code(BlockCache* cache, uint16_t start, uint16_t end) {
+    for (uint32_t address = start; address < end; ++address) {
+        if (address >= 0xFF80)
+            cache->ram_code[0x2000 + (address - 0xFF80)] = 1;
+        else
+            cache->ram_code[address - 0xC000] = 1;
+    }
+}
+
+//Decodes a block starting at pc into the given slot
+static void decode_block(BlockCache* cache, CachedBlock* block, uint16_t pc, uint16_t bank, uint32_t area_end) {
+    Memory* mem = cache->memory;
+    uint32_t address = pc;
+
+    //If a RAM block is being replaced, it doesn't count anymore
+    if (block->valid && block->in_ram)
+        --cache->num_ram_blocks;
+
+    block->valid = 1;
+    block->in_ram = pc >= 0xC000;
+    block->bank = bank;
+    block->start_pc = pc;
+    block->total_cycles = 0;
+    block->num_instructions = 0;
+    block->native = NULL;
+    block->exec_count = 0;
+
+    //ROM blocks might have been compiled ahead of time
+    block->recompiled = NULL;
+    if (cache->use_recompiled && pc < 0x8000)
+        block->recompiled = recomp_lookup(bank, pc);
+
+    while (block->num_instructions < BLOCK_MAX_INSTRUCTIONS && address < area_end) {
+        uint8_t opcode = peek(mem, address);
+        uint8_t cb_prefix = (opcode == 0xCB);
+        Instruction* info;
+        OpcodeHandler handler;
+
+        if (cb_prefix) {
+            if (address + 1 >= area_end)
+                break;
+
+            opcode = peek(mem, address + 1);
+            info = &cb_instructions[opcode];
+            handler = cb_op_handlers[opcode];
+        }
+        else {
+            info = &main_instructions[opcode];
+            handler = main_op_handlers[opcode];
+        }
+
+        //Illegal opcodes and instructions that hang off the end of the area go through the normal path
+        if (handler == NULL || address + info->num_bytes > area_end)
+            break;
+
+        CachedInstruction* instr = &block->instructions[block->num_instructions++];
+        instr->handler = handler;
+        instr->opcode = opcode;
+        instr->cb_prefix = cb_prefix;
+        instr->fetch_length = cb_prefix ? 2 : 1;
+        instr->length = (uint8_t)info->num_bytes;
+        instr->cycles = info->min_num_cycles;
+        instr->imm[0] = (!cb_prefix && info->num_bytes > 1) ? peek(mem, address + 1) : 0;
+        instr->imm[1] = (!cb_prefix && info->num_bytes > 2) ? peek(mem, address + 2) : 0;
+        instr->fusion = FUSE_NONE;
+
+        block->total_cycles += info->min_num_cycles;
+        address += info->num_bytes;
+
+        if (!cb_prefix && ends_block(opcode))
+            break;
+    }
+
+    block->end_pc = (uint16_t)address;
+
+#ifdef FUSION
+    fuse_block(block);
+#endif
+
+    block->idle_address = 0;
+#ifdef IDLE_SKIP
+    detect_idle_loop(block);
+#endif
+
+    if (block->in_ram) {
+        mark_ram_code(cache, pc, block->end_pc);
+        ++cache->num_ram_blocks;
+    }
+}
+
+//Looks up the block at pc and decodes it if it isn't cached yet
+CachedBlock* block_cache_get(BlockCache* cache, uint16_t pc) {
+    uint16_t bank;
+    uint32_t area_end;
+
+    if (!get_block_bank(cache->memory, pc, &bank, &area_end))
+        return NULL;
+
+    CachedBlock* block = &cache->blocks[(pc ^ (bank * 0x9E5)) & (BLOCK_CACHE_SIZE - 1)];
+
+    if (block->valid && block->start_pc == pc && block->bank == bank) {
+        ++cache->hits;
+    }
+    else {
+        ++cache->misses;
+        decode_block(cache, block, pc, bank, area_end);
+    }
+
+    //Nothing decodable here (ie, an illegal opcode)
+    if (block->num_instructions == 0)
+        return NULL;
+
+    return block;
+}
+
+//Throws away every block in WRAM/HRAM
+//Only happens when something writes over code that's been cached, which is pretty rare
+void block_cache_flush_ram(BlockCache* cache) {
+    if (cache->num_ram_blocks != 0) {
+        for (int i = 0; i < BLOCK_CACHE_SIZE; ++i) {
+            if (cache->blocks[i].valid && cache->blocks[i].in_ram)
+                cache->blocks[i].valid = 0;
+        }
+    }
+
+    memset(cache->ram_code, 0, sizeof(cache->ram_code));
+    cache->num_ram_blocks = 0;
+
+    ++cache->invalidations;
+    ++cache->generation;
+}
+
+void block_cache_print_stats(BlockCache* cache) {
+    uint64_t lookups = cache->hits + cache->misses;
+    double hit_rate = lookups ? (100.0 * cache->hits / lookups) : 0.0;
+
+    printf("Block cache: %llu lookups, %.2f%% hit rate, %llu RAM invalidations, %llu instructions run from cache, %llu recompiled block runs\n",
+        (unsigned long long)lookups, hit_rate, (unsigned long long)cache->invalidations,
+        (unsigned long long)cache->instructions_run, (unsigned long long)cache->recompiled_runs);
+
+    printf("  Idle loops skipped: %llu (%llu cycles)\n", (unsigned long long)cache->idle_skips,
+        (unsigned long long)cache->idle_cycles_skipped);
+
+    for (int i = FUSE_NONE + 1; i < FUSION_TYPE_COUNT; ++i)
+        printf("  Fused %s: %llu\n", fusion_patterns[i].name, (unsigned long long)cache->fusion_hits[i]);
+}
@@ -0,0 +1,32 @@
+#include "core_state.h"
+#include "logging.h"
+
+CoreState* core_state_init(Memory* mem, SDL_Data* sdl_data) {
+    if (mem == NULL || sdl_data == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Unable to initialize core state");
+        return NULL;
+    }
+
+    //Comes out of the arena zeroed, lined up to a cache line
+    CoreState* core = (CoreState*)arena_alloc(&mem->arena, sizeof(CoreState), CACHE_LINE_SIZE);
+
+    if (core == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Unable to initialize core state");
+        return NULL;
+    }
+
+    //Set up each piece in place and link them together
+    GlobalSystemState* system_state = system_state_init(&core->system_state, &core->ppu_state, &core->apu_state,
+        &core->dma_state, &core->timer_state, &core->scheduler);
+    MemoryBus* bus = memory_bus_init(&core->bus, mem, &core->system_state);
+    CPU* cpu = cpu_init(&core->cpu, &core->bus);
+    PPU* ppu = ppu_init(&core->ppu, &core->bus, &core->ppu_state, sdl_data->display_data);
+    MasterClock* sys_clock = master_clock_init(&core->sys_clock, &core->timer_state);
+    APU* apu = apu_init(&core->apu, &core->bus, &core->apu_state, sdl_data->audio_data);
+
+    //Space stays in the arena until memory is destroyed
+    if (system_state == NULL || bus == NULL || cpu == NULL || ppu == NULL || sys_clock == NULL || apu == NULL)
+        return NULL;
+
+    return core;
+}
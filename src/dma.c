@@ -0,0 +1,101 @@
+#include "dma.h"
+#include "ppu.h"
+
+#include <string.h>
+
+//Starts a transfer from 0xXX00-0xXX9F to 0xFE00-0xFE9F
+void dma_start(MemoryBus* bus, uint8_t source) {
+    GlobalDMAState* dma_state = bus->system_state->dma_state;
+    Memory* mem = bus->memory;
+
+    //DMA works like echo RAM
+    //So I am simulating this by just putting the offset into 0xDE range instead
+    if (source >= 0xFE)
+        source = source - 0xFE + 0xDE;
+
+    dma_state->active = 1;
+    dma_state->source = source;
+    dma_state->bytes_done = 0;
+    dma_state->start_time = bus->system_state->timer_state->elapsed_time; //Transfer starts on the next tick
+
+    //Anything in the read table is plain memory, so it can be copied straight from there.
+    //VRAM isn't in the table since the CPU can't always get to it, but DMA always can.
+    //This has to happen before the tables get cleared for DMA
+    dma_state->source_ptr = bus->read_pages[source];
+    if (dma_state->source_ptr == NULL && source >= 0x80 && source < 0xA0)
+        dma_state->source_ptr = get_vram_ptr(mem, (uint16_t)source << 8);
+
+    //Boot ROM can get unmapped halfway through, so that goes byte by byte too
+    if (mem->local_state.boot_rom_mapped && ((uint16_t)source << 8) < mem->boot_rom_size)
+        dma_state->source_ptr = NULL;
+
+    memory_map_update(bus); //CPU can only get to HRAM during DMA
+
+    //Byte i is done on tick 4i + 3 of the transfer, and the last one is the end
+    uint64_t first_event = (dma_state->source_ptr == NULL) ? DMA_BYTE_TICK(0) : DMA_BYTE_TICK(DMA_LENGTH - 1);
+    scheduler_post(bus->system_state->scheduler, EVENT_DMA, dma_state->start_time + first_event);
+}
+
+//Handles the DMA event. Sources without a pointer copy a byte every time, and the last byte finishes the transfer
+void dma_event(MemoryBus* bus, uint64_t time) {
+    GlobalDMAState* dma_state = bus->system_state->dma_state;
+
+    //PPU does this tick after DMA does, and it can see OAM, so it has to be caught up to right before it
+    ppu_catch_up(bus->ppu, time);
+
+    if (dma_state->source_ptr == NULL) {
+        uint8_t index = dma_state->bytes_done++;
+
+        uint8_t val = mem_read(bus, ((uint16_t)dma_state->source << 8) + index, DMA_ACCESS);
+        mem_write(bus, 0xFE00 + index, val, DMA_ACCESS);
+    }
+
+    //Transfer isn't done yet, so the next byte comes 4 ticks later
+    if (time < dma_state->start_time + DMA_BYTE_TICK(DMA_LENGTH - 1)) {
+        scheduler_post(bus->system_state->scheduler, EVENT_DMA, time + 4);
+        return;
+    }
+
+    dma_sync(bus, time);
+    dma_state->active = 0;
+
+    memory_map_update(bus); //CPU can get to everything again
+}
+
+//Catches OAM up to however many bytes the transfer would have done by the given tick
+void dma_sync(MemoryBus* bus, uint64_t time) {
+    GlobalDMAState* dma_state = bus->system_state->dma_state;
+
+    if (!dma_state->active || dma_state->source_ptr == NULL)
+        return;
+
+    //Reads from the PPU happen during a tick, so that tick counts
+    uint64_t ticks_done = time - dma_state->start_time + 1;
+    uint8_t completed = (ticks_done >= DMA_CYCLES) ? DMA_LENGTH : (uint8_t)(ticks_done / 4);
+
+    if (completed > dma_state->bytes_done) {
+        memcpy(&bus->memory->oam[dma_state->bytes_done], &dma_state->source_ptr[dma_state->bytes_done],
+            completed - dma_state->bytes_done);
+        dma_state->bytes_done = completed;
+    }
+}
+
+//The source pointer was resolved from the banks mapped when the transfer started, so before those change,
+//everything done so far (the CPU's access comes after this tick's DMA byte) gets copied from the old banks
+//and the rest goes byte by byte through the bus
+void dma_mapping_changing(MemoryBus* bus) {
+    GlobalDMAState* dma_state = bus->system_state->dma_state;
+
+    if (!dma_state->active || dma_state->source_ptr == NULL)
+        return;
+
+    uint64_t now = bus->system_state->timer_state->elapsed_time;
+
+    //PPU has to see its OAM reads up to now come from the old banks too
+    ppu_catch_up(bus->ppu, now);
+
+    dma_sync(bus, now - 1);
+    dma_state->source_ptr = NULL;
+
+    scheduler_post(bus->system_state->scheduler, EVENT_DMA, dma_state->start_time + DMA_BYTE_TICK(dma_state->bytes_done));
+}
@@ -1,6 +1,12 @@
 #include "fe_de_ex.h" 
 #include "interrupt_handler.h"
 #include "master_clock.h"
+#include "ppu.h"
+#include "opcode_table.h"
+#include "jit.h"
+#include "recomp.h"
+#include "fusion.h"
+#include "idle_loop.h"
 
 //Begins instruction loop and handles all of that fun stuff...
 int fe_de_ex(EmulatorSystem* system) {
@@ -8,7 +14,9 @@ int fe_de_ex(EmulatorSystem* system) {
     MemoryBus* bus = system->bus;
 
     while (system->system_state->running) {
-        check_interrupt(system); //Handles interrupts if there are any
+        //Handles interrupts if there are any. Usually there aren't, so that's just one check of the pending byte
+        if (anyInterruptPending(system->memory))
+            check_interrupt(system);
 
         //If EI was called, enable IME now...
         if (cpu->state.enableIME) {
@@ -19,6 +27,7 @@ int fe_de_ex(EmulatorSystem* system) {
         //Handle instruction
         //This doesn't happen if CPU is HALTed
         if (!flagIsSet(cpu, IS_HALTED)) {
+#ifdef TABLE_DISPATCH
             //Fetch instruction
             uint8_t opcode = fetch_instruction_opcode(system);
 
@@ -27,19 +36,63 @@ int fe_de_ex(EmulatorSystem* system) {
 
             //Execute instruction
             execute_instruction(system, instr);
+#elif defined(BLOCK_CACHE)
+            //Run as much of the current block as possible
+            execute_block(system);
+#else
+            //Fetch, decode and execute in one go
+            dispatch_instruction(system);
+#endif
         }
-        //If CPU is HALTED, 4 cycles pass instead
+        //If CPU is HALTED, time passes until something can wake it up
         else {
-            tick_hardware(system, 4);
+            tick_hardware(system, halt_ticks(system));
         }
     }
 
     //When emulator closes, save data
     save_save_data(system->memory);
 
+#if defined(PRINT_STATS) && defined(BLOCK_CACHE)
+    if (system->block_cache != NULL)
+        block_cache_print_stats(system->block_cache);
+    if (system->jit != NULL)
+        jit_print_stats(system->jit);
+#endif
+
     return 0;
 }
 
+//Number of ticks a HALTed CPU can skip ahead at once.
+//While HALTed, nothing changes until an enabled interrupt gets requested, and that check only happens every 4 ticks,
+//so every chunk of 4 before the earliest possible interrupt can go in one tick_hardware call with the same result
+uint16_t halt_ticks(EmulatorSystem* system) {
+    uint8_t enabled = system->memory->hram[0x7F]; //IE
+    uint32_t ticks = HALT_MAX_SKIP;
+    uint32_t horizon;
+
+    //VBlank and STAT interrupts only happen on PPU mode boundaries
+    if (enabled & ((1 << INTERRUPT_VBLANK) | (1 << INTERRUPT_LCD))) {
+        horizon = ppu_ticks_until_change(system->ppu);
+        if (horizon < ticks) { ticks = horizon; }
+    }
+
+    if (enabled & (1 << INTERRUPT_TIMER)) {
+        horizon = timer_ticks_until_overflow(system->sys_clock, system->memory);
+        if (horizon < ticks) { ticks = horizon; }
+    }
+
+    //Serial and joypad interrupts never actually get requested yet, so there's nothing to wait for there
+
+    //Stop at the end of the frame too, since that's when input gets polled and the emulator can get closed
+    uint64_t frame_end = scheduler_event_time(&system->core->scheduler, EVENT_FRAME_END);
+    uint64_t now = system->core->timer_state.elapsed_time;
+    if (frame_end != SCHEDULER_NEVER && frame_end - now < ticks) { ticks = (uint32_t)(frame_end - now); }
+
+    ticks &= ~0x3;
+    return ticks < 4 ? 4 : (uint16_t)ticks;
+}
+
 void check_interrupt(EmulatorSystem* system) {
     //If there are interrupts pending...
     if (anyInterruptPending(system->cpu->bus->memory)) {
@@ -58,9 +111,8 @@ void check_interrupt(EmulatorSystem* system) {
 //Fetches instruction and handles HALT bug
 uint8_t fetch_instruction_opcode(EmulatorSystem* system) {
     CPU* cpu = system->cpu;
-    MemoryBus* bus = system->bus;
 
-    uint8_t opcode = mem_read(bus, cpu->registers.pc++, CPU_ACCESS);
+    uint8_t opcode = fetchByte(cpu);
 
     //HALT bug will cause the PC to not increment for 1 instruction, but it will still continue execution.
     if (flagIsSet(cpu, HALT_BUG)) {
@@ -80,7 +132,7 @@ Instruction* decode_instruction(EmulatorSystem* system, uint8_t opcode) {
     }
     else {
         //Otherwise, get the CB instruction
-        opcode = mem_read(system->bus, system->cpu->registers.pc++, CPU_ACCESS);
+        opcode = fetchByte(system->cpu);
         instr = &cb_instructions[opcode];
     }
 
@@ -101,3 +153,108 @@ void execute_instruction(EmulatorSystem* system, Instruction* instr) {
         tick_hardware(system, extra_instr_time);
     }
 }
+
+#ifndef TABLE_DISPATCH
+//One case per opcode. The base cycles are a constant and the specialized handler is called directly,
+//so the compiler can turn this into a jump table instead of an indirect call through funct_ptr
+#define MAIN_CASE(opcode, function, first_op, second_op, size, cycles) \
+    case opcode: tick_hardware(system, cycles); extra_cycles = main_op_##opcode(cpu); break;
+
+#define CB_CASE(opcode, function, first_op, second_op, size, cycles) \
+    case opcode: tick_hardware(system, cycles); extra_cycles = cb_op_##opcode(cpu); break;
+
+//Fetches, decodes and executes a single instruction with one switch instead of going through the lookup tables
+void dispatch_instruction(EmulatorSystem* system) {
+    CPU* cpu = system->cpu;
+    int extra_cycles = 0;
+
+    switch (fetch_instruction_opcode(system)) {
+        MAIN_OPCODE_TABLE(MAIN_CASE)
+
+        //CB prefix just means the real opcode is in the next byte
+        case 0xCB:
+            switch (fetchByte(cpu)) {
+                CB_OPCODE_TABLE(CB_CASE)
+            }
+            break;
+
+        //Illegal opcodes lock up the real CPU, so just keep fetching the same one forever
+        default:
+            tick_hardware(system, 4);
+            --cpu->registers.pc;
+            break;
+    }
+
+    //If there are extra ticks (ie, a conditional jump occured), tick the remaining amount
+    if (extra_cycles != 0) {
+        tick_hardware(system, extra_cycles);
+    }
+}
+#endif
+
+#if defined(BLOCK_CACHE) && !defined(TABLE_DISPATCH)
+//Runs the cached block at pc, or falls back to dispatch_instruction if there isn't one
+//Timing is the same as going through dispatch_instruction one at a time, it just skips the fetch and decode.
+//The handlers still read their own immediates through the bus, so those reads happen at the same time as before.
+void execute_block(EmulatorSystem* system) {
+    CPU* cpu = system->cpu;
+    BlockCache* cache = system->block_cache;
+    CachedBlock* block = NULL;
+
+    //HALT bug and DMA both change what the fetch returns, so those go the slow way
+    if (cache != NULL && !flagIsSet(cpu, HALT_BUG) && !system->system_state->dma_state->active)
+        block = block_cache_get(cache, cpu->registers.pc);
+
+    if (block == NULL) {
+        dispatch_instruction(system);
+        return;
+    }
+
+    //Polling loops can skip straight to when the thing they're polling changes
+    if (block->idle_address != 0 && run_idle_loop(system, block))
+        return;
+
+    //Blocks compiled ahead of time for this ROM don't need anything else
+    if (block->recompiled != NULL) {
+        block->recompiled(system);
+        ++cache->recompiled_runs;
+        return;
+    }
+
+    //Hot ROM blocks run natively if the JIT is on
+    if (system->jit != NULL && jit_run_block(system->jit, block))
+        return;
+
+    uint32_t generation = cache->generation;
+
+    for (int i = 0; i < block->num_instructions; ++i) {
+        CachedInstruction* instr = &block->instructions[i];
+
+        //Fused sequences run all at once, and might stop partway through
+        if (instr->fusion != FUSE_NONE) {
+            int completed = run_fused(system, instr, generation);
+
+            ++cache->fusion_hits[instr->fusion];
+            cache->instructions_run += completed;
+
+            if (completed != fusion_patterns[instr->fusion].length)
+                break;
+
+            i += completed - 1;
+        }
+        else {
+            cpu->registers.pc += instr->fetch_length;
+            tick_hardware(system, instr->cycles);
+
+            int extra_cycles = instr->handler(cpu);
+            if (extra_cycles != 0)
+                tick_hardware(system, extra_cycles);
+
+            ++cache->instructions_run;
+        }
+
+        if (block_should_exit(system, generation))
+            break;
+    }
+}
+#endif
@@ -0,0 +1,99 @@
+#include "fusion.h"
+#include "fe_de_ex.h"
+
+const FusionPattern fusion_patterns[FUSION_TYPE_COUNT] = {
+    [FUSE_NONE] = {"none", 1, 0, 0},
+    [FUSE_COPY] = {"copy", 3, 0x3, 0x2},
+    [FUSE_COPY_COUNT] = {"copy + count", 4, 0x3, 0x2},
+    [FUSE_POLL] = {"poll", 3, 0x1, 0x0},
+    [FUSE_COUNTDOWN] = {"countdown", 2, 0x0, 0x0}
+};
+
+//Checks if instr is the main opcode given
+static uint8_t is_op(CachedInstruction* instr, uint8_t opcode) {
+    return !instr->cb_prefix && instr->opcode == opcode;
+}
+
+static uint8_t is_jr_cc(CachedInstruction* instr) {
+    return is_op(instr, 0x20) || is_op(instr, 0x28) || is_op(instr, 0x30) || is_op(instr, 0x38);
+}
+
+//dec b/c/d/e/h/l/a. dec (hl) touches memory so it's left out
+static uint8_t is_dec_r8(CachedInstruction* instr) {
+    return !instr->cb_prefix && (instr->opcode & 0xC7) == 0x05 && instr->opcode != 0x35;
+}
+
+//Works out which sequence (if any) starts at instr
+static FusionType match_fusion(CachedInstruction* instr, int remaining) {
+    //ld a,(hl+) / ld (de),a / inc de (/ dec bc)
+    if (remaining >= 3 && is_op(&instr[0], 0x2A) && is_op(&instr[1], 0x12) && is_op(&instr[2], 0x13)) {
+        if (remaining >= 4 && is_op(&instr[3], 0x0B))
+            return FUSE_COPY_COUNT;
+
+        return FUSE_COPY;
+    }
+
+    //ldh a,(n) / cp n / jr cc
+    if (remaining >= 3 && is_op(&instr[0], 0xF0) && is_op(&instr[1], 0xFE) && is_jr_cc(&instr[2]))
+        return FUSE_POLL;
+
+    //dec r / jr nz
+    if (remaining >= 2 && is_dec_r8(&instr[0]) && is_op(&instr[1], 0x20))
+        return FUSE_COUNTDOWN;
+
+    return FUSE_NONE;
+}
+
+void fuse_block(CachedBlock* block) {
+    int i = 0;
+
+    while (i < block->num_instructions) {
+        FusionType fusion = match_fusion(&block->instructions[i], block->num_instructions - i);
+        block->instructions[i].fusion = (uint8_t)fusion;
+
+        i += fusion_patterns[fusion].length;
+    }
+}
+
+//Runs a fused sequence. Returns how many of its instructions ran, which is less than the full
+//length if the block has to stop partway through (ie, an interrupt is pending with IME on)
+int run_fused(EmulatorSystem* system, CachedInstruction* instr, uint32_t generation) {
+    CPU* cpu = system->cpu;
+    const FusionPattern* pattern = &fusion_patterns[instr->fusion];
+
+    //With IME off nothing happens between instructions, so ticks only have to be exact around memory accesses
+    uint8_t merge_ticks = !flagIsSet(cpu, IME);
+    uint16_t pending_ticks = 0;
+
+    for (int i = 0; i < pattern->length; ++i) {
+        uint8_t timed = (pattern->timed_mask >> i) & 0x1;
+        uint8_t writes = (pattern->write_mask >> i) & 0x1;
+
+        cpu->registers.pc += instr[i].fetch_length;
+        pending_ticks += instr[i].cycles;
+
+        if (!merge_ticks || timed) {
+            tick_hardware(system, pending_ticks);
+            pending_ticks = 0;
+        }
+
+        pending_ticks += instr[i].handler(cpu);
+
+        //Stop points are the same as execute_block's whenever ticks aren't being merged,
+        //and a write can always change what code is mapped or start DMA
+        if (!merge_ticks || writes) {
+            if (pending_ticks != 0) {
+                tick_hardware(system, pending_ticks);
+                pending_ticks = 0;
+            }
+
+            if (i != pattern->length - 1 && block_should_exit(system, generation))
+                return i + 1;
+        }
+    }
+
+    if (pending_ticks != 0)
+        tick_hardware(system, pending_ticks);
+
+    return pattern->length;
+}
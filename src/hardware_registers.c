@@ -1,11 +1,31 @@
 #include "hardware_registers.h" 
+#include "memory_bus.h"
+#include "block_cache.h"
+#include "interrupt_handler.h"
+#include "dma.h"
+#include "apu.h"
+#include "ppu.h"
+#include "master_clock.h"
 
 //Macro to help fill this table easier
 #define HW_REG(reg, r, w, cgb) hw_registers[reg] =\
-    (HardwareRegister){.read_mask = (r), .write_mask = (w), .cgb_only = (cgb)}\
+    (HardwareRegister){.read_mask = (r), .write_mask = (w), .cgb_only = (cgb), .write = NULL, .read = NULL}\
 
 HardwareRegister hw_registers[0x80];
 
+//Register side effects
+static uint8_t joypad_read(struct MemoryBus* bus, uint16_t address, uint8_t val);
+static uint8_t timer_read(struct MemoryBus* bus, uint16_t address, uint8_t val);
+static uint8_t div_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t timer_register_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t if_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t apu_register_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t nrx4_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t nr52_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t lcdc_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t dma_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+static uint8_t boot_rom_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val);
+
 //Function to populate table with hardware register rules.
 //Lookup table stores the lower byte, as the upper byte is always 0xFF
 void init_hw_registers() {
@@ -14,7 +34,7 @@ void init_hw_registers() {
     * normal R/W registers on all versions of the console, but a handful are special.
     * I thought about including pointers here instead, allocating to the heap,
     * using a hash map, and some other stuff. But ultimately I decided that this
-    * is a table of 256 structs that are 3 bytes and this function gets called once.
+    * is a table of 128 small structs and this function gets called once.
     * The overhead for some fancy solution is just not worth saving >1KB of memory
     */
 
@@ -142,4 +162,185 @@ void init_hw_registers() {
     HW_REG(0x7D, 0x00, 0x00, 0);
     HW_REG(0x7E, 0x00, 0x00, 0);
     HW_REG(0x7F, 0x00, 0x00, 0);
+
+    /*
+    * Side effects.
+    * These used to be one big if/else chain of addresses on every IO write,
+    * now each register just has its own handler (or NULL if it doesn't do anything)
+    */
+    hw_registers[0x00].read = joypad_read;
+    hw_registers[0x04].read = timer_read;
+    hw_registers[0x05].read = timer_read;
+    hw_registers[0x04].write = div_write;
+    hw_registers[0x05].write = timer_register_write;
+    hw_registers[0x06].write = timer_register_write;
+    hw_registers[0x07].write = timer_register_write;
+    hw_registers[0x0F].write = if_write;
+
+    //APU registers are read only while the APU is off
+    for (int i = 0x10; i <= 0x25; ++i)
+        hw_registers[i].write = apu_register_write;
+
+    hw_registers[0x14].write = nrx4_write;
+    hw_registers[0x19].write = nrx4_write;
+    hw_registers[0x1E].write = nrx4_write;
+    hw_registers[0x23].write = nrx4_write;
+    hw_registers[0x26].write = nr52_write;
+
+    hw_registers[0x40].write = lcdc_write;
+    hw_registers[0x46].write = dma_write;
+    hw_registers[0x50].write = boot_rom_write;
+}
+
+//Address 0xFF00 returns current input value. This changes depending on selector bit.
+static uint8_t joypad_read(struct MemoryBus* bus, uint16_t address, uint8_t val) {
+    (void)address;
+    return get_input_byte(bus->memory, val);
+}
+
+//DIV and TIMA only get updated when they're read, so they have to catch up first
+static uint8_t timer_read(struct MemoryBus* bus, uint16_t address, uint8_t val) {
+    (void)val;
+    GlobalTimerState* timer_state = bus->system_state->timer_state;
+
+    timer_catch_up(timer_state, bus->memory, timer_state->elapsed_time);
+    return bus->memory->io[address & 0x7F];
+}
+
+//Writes to DIV reset system clock
+static uint8_t div_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    GlobalTimerState* timer_state = bus->system_state->timer_state;
+    uint64_t now = timer_state->elapsed_time;
+
+    timer_catch_up(timer_state, bus->memory, now);
+    apu_div_reset(bus->system_state->scheduler, now, timer_system_time(timer_state, now)); //Can clock DIV-APU
+    timer_state->div_reset_time = now;
+
+    //Resetting the system time moves every TIMA increment after this
+    timer_post_overflow(timer_state, bus->memory, bus->system_state->scheduler);
+    return new_val;
+}
+
+//TIMA, TMA and TAC. Everything before the write has to happen with the old value, and then the overflow gets reposted
+//with the new one, so this stores it itself
+static uint8_t timer_register_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)old_val;
+    GlobalTimerState* timer_state = bus->system_state->timer_state;
+
+    timer_catch_up(timer_state, bus->memory, timer_state->elapsed_time);
+    bus->memory->io[address & 0x7F] = new_val;
+    timer_post_overflow(timer_state, bus->memory, bus->system_state->scheduler);
+    return new_val;
+}
+
+//IF and IE decide which interrupts are pending, so this has to be stored before that gets updated
+static uint8_t if_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    bus->memory->io[0x0F] = new_val;
+    updatePendingInterrupts(bus->memory);
+    return new_val;
+}
+
+//If APU is disabled, then APU hardware registers become read only
+static uint8_t apu_register_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    if (bus->system_state->apu_state->apu_enable == 0)
+        return old_val; //Keep old val, so no writes are done
+
+    return new_val;
+}
+
+//Bit 7 of NRx4 triggers channel x
+//Bit 6 for channels 1-3 determine if the note has length timer
+static uint8_t nrx4_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    GlobalAPUState* apu_state = bus->system_state->apu_state;
+    uint8_t trigger = (new_val & 0x80) != 0;
+    uint8_t length_enable = (new_val & 0x40) != 0;
+
+    switch (address) {
+        case 0xFF14:
+            if (trigger) { apu_state->trigger_ch1 = 1; }
+            apu_state->ch1_length_enable = length_enable;
+            break;
+
+        case 0xFF19:
+            if (trigger) { apu_state->trigger_ch2 = 1; }
+            apu_state->ch2_length_enable = length_enable;
+            break;
+
+        case 0xFF1E:
+            if (trigger) { apu_state->trigger_ch3 = 1; }
+            apu_state->ch3_length_enable = length_enable;
+            break;
+
+        case 0xFF23:
+            if (trigger) { apu_state->trigger_ch4 = 1; }
+            apu_state->ch4_length_enable = length_enable;
+            break;
+    }
+
+    return apu_register_write(bus, address, new_val, old_val);
+}
+
+//Bit 7 of NR52 turns on/off APU
+static uint8_t nr52_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    if (((new_val >> 7) & 0x1) == 1)
+        bus->system_state->apu_state->apu_enable = 1; //Turn APU on
+    else
+        //Set the flag for APU to clear registers
+        bus->system_state->apu_state->turn_off_apu = 1;
+
+    return new_val;
+}
+
+//Bit 7 of LCDC controls whether PPU is on or not
+static uint8_t lcdc_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    GlobalPPUState* ppu_state = bus->system_state->ppu_state;
+
+    if (((new_val >> 7) & 0x1) == 1) {
+        //If LCD was previously off, reset frame time and turn it on
+        if (ppu_state->lcd_on == 0) {
+            ppu_state->lcd_on = 1;
+            ppu_state->frame_time = 4;
+            ppu_post_frame_end(bus->system_state->scheduler, ppu_state, bus->system_state->timer_state->elapsed_time);
+        }
+    }
+    else if (ppu_state->lcd_on) {
+        ppu_state->lcd_on = 0;
+        ppu_post_frame_end(bus->system_state->scheduler, ppu_state, bus->system_state->timer_state->elapsed_time);
+    }
+
+    return new_val;
+}
+
+//This register begins DMA transfer if its not active already
+static uint8_t dma_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    if (!bus->system_state->dma_state->active)
+        dma_start(bus, new_val);
+
+    return new_val;
+}
+
+//Writes here disable boot rom
+static uint8_t boot_rom_write(struct MemoryBus* bus, uint16_t address, uint8_t new_val, uint8_t old_val) {
+    (void)address;
+    (void)old_val;
+    if (bus->memory->local_state.boot_rom_mapped == 1) {
+        disable_bootrom(bus->memory);
+        memory_map_update(bus); //Boot ROM is unmapped, so nothing can point at it anymore
+
+        if (bus->block_cache != NULL)
+            block_cache_mapping_changed(bus->block_cache);
+    }
+
+    return new_val;
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "idle_loop.h"
+#include "master_clock.h"
+#include "ppu.h"
+
+//Registers a loop can poll. Only the hardware changes these, and reading them has no side effects
+static uint8_t is_polled_register(uint16_t address) {
+    return address == 0xFF04 || address == 0xFF05 || address == 0xFF0F || address == 0xFF41 || address == 0xFF44;
+}
+
+//Instructions allowed after the read. They only work on A and the flags, so each pass ends the same way
+static uint8_t is_pure_instruction(CachedInstruction* instr) {
+    if (instr->cb_prefix)
+        return (instr->opcode & 0xC7) == 0x47; //bit b,a
+
+    return instr->opcode == 0xFE || instr->opcode == 0xE6; //cp n, and n
+}
+
+//Works out where a jump at the end of the block goes, or returns -1 if it isn't a direct jump
+static int32_t jump_target(CachedBlock* block, CachedInstruction* instr) {
+    if (instr->cb_prefix)
+        return -1;
+
+    switch (instr->opcode) {
+        //jr (cc,) e
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+            return (uint16_t)(block->end_pc + (int8_t)instr->imm[0]);
+
+        //jp (cc,) a16
+        case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+            return (uint16_t)(instr->imm[0] | (instr->imm[1] << 8));
+
+        default:
+            return -1;
+    }
+}
+
+void detect_idle_loop(CachedBlock* block) {
+    block->idle_address = 0;
+
+    if (block->num_instructions < 2)
+        return;
+
+    CachedInstruction* read = &block->instructions[0];
+    CachedInstruction* jump = &block->instructions[block->num_instructions - 1];
+    uint16_t address;
+
+    //ldh a,(n) or ld a,(a16)
+    if (!read->cb_prefix && read->opcode == 0xF0)
+        address = 0xFF00 | read->imm[0];
+    else if (!read->cb_prefix && read->opcode == 0xFA)
+        address = read->imm[0] | (read->imm[1] << 8);
+    else
+        return;
+
+    if (!is_polled_register(address) || jump_target(block, jump) != block->start_pc)
+        return;
+
+    for (int i = 1; i < block->num_instructions - 1; ++i) {
+        if (!is_pure_instruction(&block->instructions[i]))
+            return;
+    }
+
+    block->idle_address = address;
+}
+
+//How many upcoming ticks leave the polled register the same
+static uint32_t ticks_until_change(EmulatorSystem* system, uint16_t address) {
+    uint32_t ticks;
+
+    switch (address) {
+        case 0xFF04:
+            return timer_ticks_until_div_change(system->sys_clock, system->memory);
+
+        case 0xFF05:
+            return timer_ticks_until_tima_change(system->sys_clock, system->memory);
+
+        case 0xFF44:
+            return ppu_ticks_until_ly_change(system->ppu);
+
+        case 0xFF41:
+            return ppu_ticks_until_change(system->ppu);
+
+        //IF gets set by the PPU and the timer
+        case 0xFF0F:
+            ticks = ppu_ticks_until_change(system->ppu);
+            if (timer_ticks_until_overflow(system->sys_clock, system->memory) < ticks)
+                ticks = timer_ticks_until_overflow(system->sys_clock, system->memory);
+            return ticks;
+
+        default:
+            return 0;
+    }
+}
+
+uint8_t run_idle_loop(EmulatorSystem* system, CachedBlock* block) {
+    CPU* cpu = system->cpu;
+    BlockCache* cache = system->block_cache;
+    GlobalTimerState* timer_state = system->sys_clock->global_state;
+
+    //An interrupt could fire partway through the skipped passes
+    if (flagIsSet(cpu, IME) && (system->memory->hram[0x7F] & 0x1F))
+        return 0;
+
+    uint16_t start_pc = cpu->registers.pc;
+    uint64_t read_time = 0;
+    uint8_t read_value = 0;
+
+    //One normal pass. Nothing in the loop writes memory or touches IME, so the only thing worth stopping for is the emulator closing
+    for (int i = 0; i < block->num_instructions; ++i) {
+        CachedInstruction* instr = &block->instructions[i];
+
+        cpu->registers.pc += instr->fetch_length;
+        tick_hardware(system, instr->cycles);
+
+        int extra_cycles = instr->handler(cpu);
+        if (extra_cycles != 0)
+            tick_hardware(system, extra_cycles);
+
+        ++cache->instructions_run;
+
+        if (i == 0) {
+            read_time = timer_state->elapsed_time;
+            read_value = cpu->registers.A;
+        }
+
+        if (!system->system_state->running)
+            return 1;
+    }
+
+    //Loop finished, so whatever it was waiting for happened
+    if (cpu->registers.pc != start_pc)
+        return 1;
+
+    //Register already changed during the rest of the pass, so the next pass is different anyway
+    if (mem_read(system->bus, block->idle_address, CPU_ACCESS) != read_value)
+        return 1;
+
+    //Every pass from here reads the same value as long as the read lands before the register changes.
+    //The read in pass k happens after read_cycles + k * pass_cycles ticks
+    uint32_t read_cycles = block->instructions[0].cycles;
+    uint32_t pass_cycles = read_cycles + (uint32_t)(timer_state->elapsed_time - read_time);
+    uint32_t unchanged_ticks = ticks_until_change(system, block->idle_address);
+
+    if (unchanged_ticks < read_cycles)
+        return 1;
+
+    uint32_t passes = (unchanged_ticks - read_cycles) / pass_cycles + 1;
+    if (passes > IDLE_MAX_SKIP / pass_cycles)
+        passes = IDLE_MAX_SKIP / pass_cycles;
+
+    //Skipped passes leave the CPU exactly how the pass above did, so only the hardware needs to catch up
+    if (passes != 0) {
+        tick_hardware(system, (uint16_t)(passes * pass_cycles));
+
+        ++cache->idle_skips;
+        cache->idle_cycles_skipped += passes * pass_cycles;
+    }
+
+    return 1;
+}
@@ -1,16 +1,65 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "init.h" 
 #include "logging.h"
 #include "fe_de_ex.h"
 #include "instructions.h"
 #include "hardware_registers.h"
 #include "sdl_data.h"
+#include "jit.h"
+#include "save_file.h"
 
 #define GAME_NAME "game.gb"
 #define BOOTROM_DIR "boot.bin"
 
-int emulator_init() {
+//Fills in options from the command line
+//Returns 1 if something in there doesn't make sense
+int parse_options(int argc, char** argv, EmulatorOptions* options) {
+    options->rom_path = GAME_NAME;
+    options->use_jit = 0;
+    options->frame_limit = 0;
+    options->save_interval = SAVE_FLUSH_INTERVAL_DEFAULT;
+    options->log_level = LOG_LEVEL_DEFAULT;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--jit") == 0)
+            options->use_jit = 1;
+
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options->frame_limit = (uint32_t)strtoul(argv[++i], NULL, 10);
+
+        else if (strcmp(argv[i], "--save-interval") == 0 && i + 1 < argc)
+            options->save_interval = (uint32_t)strtoul(argv[++i], NULL, 10);
+
+        else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            if (log_parse_level(argv[++i], &options->log_level))
+                return 1;
+        }
+
+        //Anything that isn't an option is the ROM
+        else if (argv[i][0] != '-')
+            options->rom_path = argv[i];
+
+        else
+            return 1;
+    }
+
+    return 0;
+}
+
+void print_usage() {
+    printf("Usage: clair-dmg [rom] [--jit] [--frames N] [--save-interval MS] [--log-level LEVEL]\n");
+    printf("  rom         ROM file to run (default %s)\n", GAME_NAME);
+    printf("  --jit       Run hot code through the x86-64 recompiler\n");
+    printf("  --frames N  Quit after N frames and print how long they took\n");
+    printf("  --save-interval MS  How often battery saves get flushed to disk (default %d, 0 only on close)\n",
+        SAVE_FLUSH_INTERVAL_DEFAULT);
+    printf("  --log-level LEVEL   error, warning, info or debug (default warning)\n");
+}
+
+int emulator_init(EmulatorOptions* options) {
     init_opcodes();
     init_hw_registers();
 
@@ -21,7 +70,7 @@ int emulator_init() {
 
     //Open ROM file
     //Open save file if it exists
-    FILE* rom_file = fopen(GAME_NAME, "rb");
+    FILE* rom_file = fopen(options->rom_path, "rb");
     FILE* boot_rom_file = fopen(BOOTROM_DIR, "rb");
 
     //Emulator System initialization
@@ -44,8 +93,28 @@ int emulator_init() {
     if (system->memory->boot_rom == NULL)
         init_cpu_vals(system); 
 
-    //Begin instruction loop!
+    //JIT is optional, if it can't start the interpreter just runs everything
+    if (options->use_jit)
+        system->jit = jit_init(system);
+
+    system->frame_limit = options->frame_limit;
+
+    //Battery saves get flushed in the background, so a crash doesn't lose anything
+    if (system->memory->save_file != NULL)
+        save_file_start_flusher(system->memory->save_file, options->save_interval);
+
+    //Begin instruction loop! Benchmark is wall time, since the logging and save threads shouldn't count towards it
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
     int success = fe_de_ex(system);
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    //Benchmark results, so the interpreter and JIT can be compared on the same ROM
+    if (options->frame_limit != 0) {
+        double seconds = (double)(end_time.tv_sec - start_time.tv_sec) + (end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+        printf("Ran %u frames in %.3f seconds (%.1f frames/s, %s)\n", system->frames_run, seconds,
+            seconds > 0 ? system->frames_run / seconds : 0.0, system->jit != NULL ? "JIT" : "interpreter");
+    }
 
     //Delete SDL stuff after instruction loop
     if (sdl_data != NULL)
@@ -14,63 +14,28 @@ void serviceInterrupt(CPU* cpu) {
     if (!mem_write(cpu->bus, cpu->registers.sp - 1, pc_lsb, CPU_ACCESS)) { --cpu->registers.sp; }
 
     //Default value in case SOMEHOW this function is called when an interrupt is not actually pending, so no jump will happen
+    //(the pushes can land on IE, so this really can happen)
     uint16_t target_address = 0x0;
+    uint8_t pending = cpu->bus->memory->local_state.pending_interrupts;
 
-    //Gets highest priority interrupt address and clears pending interrupt
-    if (interruptPending(INTERRUPT_VBLANK, cpu->bus->memory)) {
-        target_address = 0x40;
-        clearInterrupt(INTERRUPT_VBLANK, cpu->bus->memory);
-    }
-
-    else if (interruptPending(INTERRUPT_LCD, cpu->bus->memory)) {
-        target_address = 0x48;
-        clearInterrupt(INTERRUPT_LCD, cpu->bus->memory);
-    }
+    //Lowest bit is the highest priority. Vectors are 0x40, 0x48, 0x50, 0x58, 0x60 in the same order
+    if (pending != 0) {
+        Interrupt interrupt = (Interrupt)lowestSetBit(pending);
 
-    else if (interruptPending(INTERRUPT_TIMER, cpu->bus->memory)) {
-        target_address = 0x50;
-        clearInterrupt(INTERRUPT_TIMER, cpu->bus->memory);
-    }
-
-    else if (interruptPending(INTERRUPT_SERIAL, cpu->bus->memory)) {
-        target_address = 0x58;
-        clearInterrupt(INTERRUPT_SERIAL, cpu->bus->memory);
-    }
-
-    else if (interruptPending(INTERRUPT_JOYPAD, cpu->bus->memory)) {
-        target_address = 0x60;
-        clearInterrupt(INTERRUPT_JOYPAD, cpu->bus->memory);
+        target_address = 0x40 + (interrupt * 0x8);
+        clearInterrupt(interrupt, cpu->bus->memory);
     }
 
     clearFlag(cpu, IME); //Reset IME
     cpu->registers.pc = target_address; //Jumps to address
 }
 
-//Checks if specific interrupt can be serviced
-int interruptPending(Interrupt interrupt, Memory* mem) {
-    uint8_t IE = mem->hram[0x7F];
-    uint8_t IF = mem->io[0x0F];
-
-    return ((IE >> interrupt) & 0x01) && ((IF >> interrupt) & 0x01);    
-}
-
-//Checks if there are ANY interrupts that can be serviced
-int anyInterruptPending(Memory* mem) {
-    //If there are interrupts that are waiting AND can be serviced, set flag
-    int interruptsWaiting = 0;
-    for (int i = 0; i <= 4; ++i) {
-        if (interruptPending(i, mem) == 1) 
-            interruptsWaiting = 1;
-    }
-
-    return interruptsWaiting;
-}
-
 //Sets interrupt flag
 void requestInterrupt(Interrupt interrupt, Memory* mem) {
     uint8_t* IF = &mem->io[0x0F];
     
     *IF |= (1 << interrupt);
+    updatePendingInterrupts(mem);
 }
 
 //Clears interrupt
@@ -78,4 +43,13 @@ void clearInterrupt(Interrupt interrupt, Memory* mem) {
     uint8_t* IF = &mem->io[0x0F];
 
     *IF &= ~(1 << interrupt);
+    updatePendingInterrupts(mem);
+}
+
+//Works out which interrupts can be serviced from IE and IF
+void updatePendingInterrupts(Memory* mem) {
+    uint8_t IE = mem->hram[0x7F];
+    uint8_t IF = mem->io[0x0F];
+
+    mem->local_state.pending_interrupts = IE & IF & INTERRUPT_MASK;
 }
\ No newline at end of file
@@ -0,0 +1,656 @@
+#include "jit.h"
+#include "logging.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#ifdef JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define JIT_EPILOGUE_SIZE 6 //pop r13, pop r12, pop rbx, ret
+
+//Byte emitter for the translation currently being written
+typedef struct {
+    uint8_t* start;
+    uint8_t* ptr;
+
+    //rel32 jumps to the block exit, patched once the exit's address is known
+    uint8_t* exit_jumps[BLOCK_MAX_INSTRUCTIONS * 5];
+    int num_exit_jumps;
+} Emitter;
+
+static void emit_byte(Emitter* e, uint8_t val) {
+    *e->ptr++ = val;
+}
+
+static void emit_bytes(Emitter* e, const uint8_t* bytes, size_t len) {
+    memcpy(e->ptr, bytes, len);
+    e->ptr += len;
+}
+
+static void emit_u32(Emitter* e, uint32_t val) {
+    memcpy(e->ptr, &val, 4);
+    e->ptr += 4;
+}
+
+static void emit_u64(Emitter* e, uint64_t val) {
+    memcpy(e->ptr, &val, 8);
+    e->ptr += 8;
+}
+
+//mov rax, imm64
+static void emit_mov_rax(Emitter* e, const void* ptr) {
+    emit_bytes(e, (const uint8_t[]){0x48, 0xB8}, 2);
+    emit_u64(e, (uint64_t)(uintptr_t)ptr);
+}
+
+//call through rax, since the handlers are usually too far away for a rel32 call
+static void emit_call(Emitter* e, const void* fn) {
+    emit_mov_rax(e, fn);
+    emit_bytes(e, (const uint8_t[]){0xFF, 0xD0}, 2); //call rax
+}
+
+//jcc rel32 to the block exit. cc is the second byte of the 0F 8x opcode
+static void emit_exit_jump(Emitter* e, uint8_t cc) {
+    emit_bytes(e, (const uint8_t[]){0x0F, cc}, 2);
+    e->exit_jumps[e->num_exit_jumps++] = e->ptr;
+    emit_u32(e, 0);
+}
+
+//tick_hardware(system, cycles). rbx holds the system pointer
+static void emit_tick(Emitter* e, uint8_t cycles) {
+    emit_bytes(e, (const uint8_t[]){0x48, 0x89, 0xDF}, 3); //mov rdi, rbx
+    emit_byte(e, 0xBE); //mov esi, imm32
+    emit_u32(e, cycles);
+    emit_call(e, (const void*)tick_hardware);
+}
+
+//x86 registers the emitters below use as scratch
+#define X86_EAX 0
+#define X86_ECX 1
+#define X86_EDX 2
+#define X86_ESI 6
+
+//movzx reg, byte [r12 + offset]
+static void emit_load8(Emitter* e, uint8_t reg, size_t offset) {
+    emit_bytes(e, (const uint8_t[]){0x41, 0x0F, 0xB6, 0x84 | (reg << 3), 0x24}, 5);
+    emit_u32(e, (uint32_t)offset);
+}
+
+//mov byte [r12 + offset], reg. Only al, cl and dl
+static void emit_store8(Emitter* e, uint8_t reg, size_t offset) {
+    emit_bytes(e, (const uint8_t[]){0x41, 0x88, 0x84 | (reg << 3), 0x24}, 4);
+    emit_u32(e, (uint32_t)offset);
+}
+
+//mov byte [r12 + offset], imm8
+static void emit_store8_imm(Emitter* e, size_t offset, uint8_t val) {
+    emit_bytes(e, (const uint8_t[]){0x41, 0xC6, 0x84, 0x24}, 4);
+    emit_u32(e, (uint32_t)offset);
+    emit_byte(e, val);
+}
+
+//mov reg, imm32
+static void emit_mov_imm32(Emitter* e, uint8_t reg, uint32_t val) {
+    emit_byte(e, 0xB8 + reg);
+    emit_u32(e, val);
+}
+
+//add word [r12 + pc], imm8
+static void emit_pc_add(Emitter* e, uint8_t amount) {
+    emit_bytes(e, (const uint8_t[]){0x66, 0x41, 0x83, 0x84, 0x24}, 5);
+    emit_u32(e, (uint32_t)offsetof(CPU, registers.pc));
+    emit_byte(e, amount);
+}
+
+//Short jump forward, patched with patch_jump8 once the target is emitted
+static uint8_t* emit_jump8(Emitter* e, uint8_t opcode) {
+    emit_byte(e, opcode);
+    emit_byte(e, 0);
+    return e->ptr - 1;
+}
+
+static void patch_jump8(Emitter* e, uint8_t* rel) {
+    *rel = (uint8_t)(e->ptr - (rel + 1));
+}
+
+//Register offsets in the CPU struct, in the same order opcodes encode them (6 is (HL))
+static const size_t reg_offsets[8] = {
+    offsetof(CPU, registers.B), offsetof(CPU, registers.C),
+    offsetof(CPU, registers.D), offsetof(CPU, registers.E),
+    offsetof(CPU, registers.H), offsetof(CPU, registers.L),
+    0, offsetof(CPU, registers.A)
+};
+
+#define REG_OFFSET_A offsetof(CPU, registers.A)
+#define REG_OFFSET_F offsetof(CPU, registers.F)
+
+//esi = hi << 8 | lo, for an address in a register pair
+static void emit_pair_address(Emitter* e, size_t hi, size_t lo) {
+    emit_load8(e, X86_ESI, hi);
+    emit_bytes(e, (const uint8_t[]){0xC1, 0xE6, 0x08}, 3); //shl esi, 8
+    emit_load8(e, X86_EAX, lo);
+    emit_bytes(e, (const uint8_t[]){0x09, 0xC6}, 2); //or esi, eax
+}
+
+//Stores esi + delta back into H and L, for (HL+) and (HL-)
+static void emit_hl_step(Emitter* e, int8_t delta) {
+    emit_bytes(e, (const uint8_t[]){0x8D, 0x4E, (uint8_t)delta}, 3); //lea ecx, [rsi + delta]
+    emit_store8(e, X86_ECX, reg_offsets[5]);
+    emit_bytes(e, (const uint8_t[]){0xC1, 0xE9, 0x08}, 3); //shr ecx, 8
+    emit_store8(e, X86_ECX, reg_offsets[4]);
+}
+
+//al = mem_read(bus, esi, CPU_ACCESS)
+static void emit_mem_read(Emitter* e, JIT* jit) {
+    emit_bytes(e, (const uint8_t[]){0x48, 0xBF}, 2); //mov rdi, bus
+    emit_u64(e, (uint64_t)(uintptr_t)jit->system->cpu->bus);
+    emit_mov_imm32(e, X86_EDX, CPU_ACCESS);
+    emit_call(e, (const void*)mem_read);
+}
+
+//mem_write(bus, esi, edx, CPU_ACCESS). The value has to be in edx already
+static void emit_mem_write(Emitter* e, JIT* jit) {
+    emit_bytes(e, (const uint8_t[]){0x48, 0xBF}, 2); //mov rdi, bus
+    emit_u64(e, (uint64_t)(uintptr_t)jit->system->cpu->bus);
+    emit_mov_imm32(e, X86_ECX, CPU_ACCESS);
+    emit_call(e, (const void*)mem_write);
+}
+
+//Makes sure F is up to date before an op that reads part of it (ADC/SBC carry, INC/DEC keeping C)
+//Same as syncFlags, so it only calls out when there's a lazy op pending
+static void emit_sync_flags(Emitter* e) {
+#ifdef LAZY_FLAGS
+    emit_bytes(e, (const uint8_t[]){0x41, 0x80, 0xBC, 0x24}, 4); //cmp byte [r12 + op], LAZY_NONE
+    emit_u32(e, (uint32_t)offsetof(CPU, lazy_flags.op));
+    emit_byte(e, LAZY_NONE);
+    uint8_t* skip = emit_jump8(e, 0x74); //je
+    emit_bytes(e, (const uint8_t[]){0x4C, 0x89, 0xE7}, 3); //mov rdi, r12
+    emit_call(e, (const void*)resolveFlags);
+    patch_jump8(e, skip);
+#else
+    (void)e;
+#endif
+}
+
+//Stores the F that's been worked out in cl. Natively emitted ops always leave F up to date
+static void emit_store_flags(Emitter* e) {
+    emit_store8(e, X86_ECX, REG_OFFSET_F);
+#ifdef LAZY_FLAGS
+    emit_store8_imm(e, offsetof(CPU, lazy_flags.op), LAZY_NONE);
+#endif
+}
+
+//ecx = Z and H out of the flags lahf put in ah, already shifted to where F keeps them
+//(ZF is bit 6 and AF is bit 4, Z and H are one above that)
+static void emit_zh_from_ah(Emitter* e) {
+    emit_bytes(e, (const uint8_t[]){0x0F, 0xB6, 0xCC}, 3); //movzx ecx, ah
+    emit_bytes(e, (const uint8_t[]){0x83, 0xE1, 0x50}, 3); //and ecx, 0x50
+    emit_bytes(e, (const uint8_t[]){0x01, 0xC9}, 2); //add ecx, ecx
+}
+
+/*
+* 8-bit ALU op on A, with the other operand already in cl.
+* x86 sets ZF, AF and CF exactly the way the Gameboy sets Z, H and C for all of these (AF is the carry/borrow
+* out of bit 3, and ADC/SBB include the carry in), so F comes straight out of lahf instead of being worked out.
+* AND/OR/XOR don't have a meaningful AF, but H and C are constants for those anyway.
+*/
+static void emit_alu(Emitter* e, uint8_t alu_op) {
+    //x86 opcodes for op r/m8, r8, in the same order as the Gameboy encodes them (ADD ADC SUB SBC AND XOR OR CP)
+    static const uint8_t x86_ops[8] = {0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38};
+
+    emit_load8(e, X86_EAX, REG_OFFSET_A);
+
+    //ADC/SBC, carry in goes in CF
+    if (alu_op == 1 || alu_op == 3) {
+        emit_load8(e, X86_EDX, REG_OFFSET_F);
+        emit_bytes(e, (const uint8_t[]){0x0F, 0xBA, 0xE2, 0x04}, 4); //bt edx, 4
+    }
+
+    emit_bytes(e, (const uint8_t[]){x86_ops[alu_op], 0xC8}, 2); //op al, cl
+    emit_byte(e, 0x9F); //lahf
+
+    //CP throws the result away
+    if (alu_op != 7)
+        emit_store8(e, X86_EAX, REG_OFFSET_A);
+
+    if (alu_op >= 4 && alu_op <= 6) {
+        //Z, plus H for AND
+        emit_bytes(e, (const uint8_t[]){0x0F, 0xB6, 0xCC}, 3); //movzx ecx, ah
+        emit_bytes(e, (const uint8_t[]){0x83, 0xE1, 0x40}, 3); //and ecx, 0x40
+        emit_bytes(e, (const uint8_t[]){0x01, 0xC9}, 2); //add ecx, ecx
+        if (alu_op == 4)
+            emit_bytes(e, (const uint8_t[]){0x83, 0xC9, 0x20}, 3); //or ecx, 0x20
+    }
+    else {
+        emit_bytes(e, (const uint8_t[]){0x0F, 0xB6, 0xD4}, 3); //movzx edx, ah
+        emit_zh_from_ah(e);
+        emit_bytes(e, (const uint8_t[]){0x83, 0xE2, 0x01}, 3); //and edx, 1 (CF)
+        emit_bytes(e, (const uint8_t[]){0xC1, 0xE2, 0x04}, 3); //shl edx, 4
+        emit_bytes(e, (const uint8_t[]){0x09, 0xD1}, 2); //or ecx, edx
+        if (alu_op >= 2)
+            emit_bytes(e, (const uint8_t[]){0x83, 0xC9, 0x40}, 3); //or ecx, 0x40 (N)
+    }
+
+    emit_store_flags(e);
+}
+
+//INC r / DEC r. Same idea as emit_alu, but C stays whatever it was
+static void emit_inc_dec(Emitter* e, size_t reg_offset, uint8_t is_dec) {
+    emit_load8(e, X86_EAX, reg_offset);
+    emit_bytes(e, (const uint8_t[]){0xFE, is_dec ? 0xC8 : 0xC0}, 2); //dec al / inc al
+    emit_byte(e, 0x9F); //lahf
+    emit_store8(e, X86_EAX, reg_offset);
+
+    emit_zh_from_ah(e);
+    emit_load8(e, X86_EDX, REG_OFFSET_F);
+    emit_bytes(e, (const uint8_t[]){0x83, 0xE2, 0x10}, 3); //and edx, 0x10
+    emit_bytes(e, (const uint8_t[]){0x09, 0xD1}, 2); //or ecx, edx
+    if (is_dec)
+        emit_bytes(e, (const uint8_t[]){0x83, 0xC9, 0x40}, 3); //or ecx, 0x40 (N)
+
+    emit_store_flags(e);
+}
+
+/*
+* Emits the instruction natively if it's one of the loads or ALU ops.
+* Runs after the pc update and tick for the opcode, same as a handler would. Immediates come from the ones the
+* block cache read when decoding (ROM can't change under a block), and the pc still moves past them.
+* Memory operands call mem_read/mem_write directly, so every access still happens at the same time as before.
+* Returns 0 if it has to go through its handler instead
+*/
+static uint8_t emit_native(Emitter* e, JIT* jit, CachedInstruction* instr) {
+    uint8_t op = instr->opcode;
+
+    if (instr->cb_prefix)
+        return 0;
+
+    //NOP
+    if (op == 0x00)
+        return 1;
+
+    //LD r,r / LD r,(HL) / LD (HL),r
+    if (op >= 0x40 && op < 0x80 && op != 0x76) {
+        uint8_t dest = (op >> 3) & 0x7;
+        uint8_t src = op & 0x7;
+
+        if (src == 6) {
+            emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            emit_mem_read(e, jit);
+            emit_store8(e, X86_EAX, reg_offsets[dest]);
+        }
+        else if (dest == 6) {
+            emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            emit_load8(e, X86_EDX, reg_offsets[src]);
+            emit_mem_write(e, jit);
+        }
+        else {
+            //Doesn't touch memory or flags, so it's just a byte copy inside the CPU struct
+            emit_load8(e, X86_EAX, reg_offsets[src]);
+            emit_store8(e, X86_EAX, reg_offsets[dest]);
+        }
+        return 1;
+    }
+
+    //ALU A,r / ALU A,(HL)
+    if (op >= 0x80 && op < 0xC0) {
+        uint8_t alu_op = (op >> 3) & 0x7;
+
+        if (alu_op == 1 || alu_op == 3)
+            emit_sync_flags(e);
+
+        if ((op & 0x7) == 6) {
+            emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            emit_mem_read(e, jit);
+            emit_bytes(e, (const uint8_t[]){0x89, 0xC1}, 2); //mov ecx, eax
+        }
+        else {
+            emit_load8(e, X86_ECX, reg_offsets[op & 0x7]);
+        }
+
+        emit_alu(e, alu_op);
+        return 1;
+    }
+
+    //ALU A,d8
+    if ((op & 0xC7) == 0xC6) {
+        uint8_t alu_op = (op >> 3) & 0x7;
+
+        if (alu_op == 1 || alu_op == 3)
+            emit_sync_flags(e);
+
+        emit_pc_add(e, 1);
+        emit_mov_imm32(e, X86_ECX, instr->imm[0]);
+        emit_alu(e, alu_op);
+        return 1;
+    }
+
+    //INC r / DEC r. (HL) ones are read-modify-write, so those stay in the handler
+    if (op < 0x40 && ((op & 0x7) == 4 || (op & 0x7) == 5) && op != 0x34 && op != 0x35) {
+        emit_sync_flags(e);
+        emit_inc_dec(e, reg_offsets[(op >> 3) & 0x7], (op & 0x7) == 5);
+        return 1;
+    }
+
+    //LD r,d8 / LD (HL),d8
+    if (op < 0x40 && (op & 0x7) == 6) {
+        uint8_t dest = (op >> 3) & 0x7;
+
+        emit_pc_add(e, 1);
+        if (dest == 6) {
+            emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            emit_mov_imm32(e, X86_EDX, instr->imm[0]);
+            emit_mem_write(e, jit);
+        }
+        else {
+            emit_store8_imm(e, reg_offsets[dest], instr->imm[0]);
+        }
+        return 1;
+    }
+
+    switch (op) {
+        //LD rr,d16
+        case 0x01: case 0x11: case 0x21: {
+            uint8_t pair = (op >> 4) * 2; //B, D or H
+            emit_pc_add(e, 2);
+            emit_store8_imm(e, reg_offsets[pair], instr->imm[1]);
+            emit_store8_imm(e, reg_offsets[pair + 1], instr->imm[0]);
+            return 1;
+        }
+        case 0x31:
+            emit_pc_add(e, 2);
+            emit_bytes(e, (const uint8_t[]){0x66, 0x41, 0xC7, 0x84, 0x24}, 5); //mov word [r12 + sp], imm16
+            emit_u32(e, (uint32_t)offsetof(CPU, registers.sp));
+            emit_bytes(e, instr->imm, 2);
+            return 1;
+
+        //LD (BC),A / LD (DE),A / LD (HL+),A / LD (HL-),A
+        case 0x02: case 0x12: case 0x22: case 0x32:
+            if (op < 0x20)
+                emit_pair_address(e, reg_offsets[(op >> 4) * 2], reg_offsets[(op >> 4) * 2 + 1]);
+            else
+                emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            if (op >= 0x20)
+                emit_hl_step(e, op == 0x22 ? 1 : -1);
+            emit_load8(e, X86_EDX, REG_OFFSET_A);
+            emit_mem_write(e, jit);
+            return 1;
+
+        //LD A,(BC) / LD A,(DE) / LD A,(HL+) / LD A,(HL-)
+        case 0x0A: case 0x1A: case 0x2A: case 0x3A:
+            if (op < 0x20)
+                emit_pair_address(e, reg_offsets[(op >> 4) * 2], reg_offsets[(op >> 4) * 2 + 1]);
+            else
+                emit_pair_address(e, reg_offsets[4], reg_offsets[5]);
+            if (op >= 0x20)
+                emit_hl_step(e, op == 0x2A ? 1 : -1);
+            emit_mem_read(e, jit);
+            emit_store8(e, X86_EAX, REG_OFFSET_A);
+            return 1;
+
+        //LDH (n),A / LD (nn),A / LD (C),A
+        case 0xE0: case 0xEA: case 0xE2:
+            if (op == 0xE2) {
+                emit_load8(e, X86_ESI, reg_offsets[1]);
+                emit_bytes(e, (const uint8_t[]){0x81, 0xCE, 0x00, 0xFF, 0x00, 0x00}, 6); //or esi, 0xFF00
+            }
+            else {
+                emit_pc_add(e, instr->length - 1);
+                emit_mov_imm32(e, X86_ESI, op == 0xE0 ? 0xFF00 | instr->imm[0] : instr->imm[0] | (instr->imm[1] << 8));
+            }
+            emit_load8(e, X86_EDX, REG_OFFSET_A);
+            emit_mem_write(e, jit);
+            return 1;
+
+        //LDH A,(n) / LD A,(nn) / LD A,(C)
+        case 0xF0: case 0xFA: case 0xF2:
+            if (op == 0xF2) {
+                emit_load8(e, X86_ESI, reg_offsets[1]);
+                emit_bytes(e, (const uint8_t[]){0x81, 0xCE, 0x00, 0xFF, 0x00, 0x00}, 6); //or esi, 0xFF00
+            }
+            else {
+                emit_pc_add(e, instr->length - 1);
+                emit_mov_imm32(e, X86_ESI, op == 0xF0 ? 0xFF00 | instr->imm[0] : instr->imm[0] | (instr->imm[1] << 8));
+            }
+            emit_mem_read(e, jit);
+            emit_store8(e, X86_EAX, REG_OFFSET_A);
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+//Same checks execute_block does between instructions
+static void emit_exit_checks(Emitter* e, JIT* jit) {
+    EmulatorSystem* system = jit->system;
+
+    //Emulator closed
+    emit_mov_rax(e, &system->system_state->running);
+    emit_bytes(e, (const uint8_t[]){0x80, 0x38, 0x00}, 3); //cmp byte [rax], 0
+    emit_exit_jump(e, 0x84); //je
+
+    //Mapping changed. r13d holds the generation from when the block started
+    emit_mov_rax(e, &jit->cache->generation);
+    emit_bytes(e, (const uint8_t[]){0x44, 0x39, 0x28}, 3); //cmp [rax], r13d
+    emit_exit_jump(e, 0x85); //jne
+
+    //DMA started
+    emit_mov_rax(e, &system->system_state->dma_state->active);
+    emit_bytes(e, (const uint8_t[]){0x80, 0x38, 0x00}, 3); //cmp byte [rax], 0
+    emit_exit_jump(e, 0x85); //jne
+
+    //EI ran
+    emit_mov_rax(e, &system->cpu->state.enableIME);
+    emit_bytes(e, (const uint8_t[]){0x83, 0x38, 0x00}, 3); //cmp dword [rax], 0
+    emit_exit_jump(e, 0x85); //jne
+
+    //Interrupt pending with IME set, same as anyInterruptPending && IME
+    emit_mov_rax(e, &system->memory->local_state.pending_interrupts);
+    emit_bytes(e, (const uint8_t[]){0x80, 0x38, 0x00}, 3); //cmp byte [rax], 0
+    uint8_t* none_pending = emit_jump8(e, 0x74); //je
+    emit_mov_rax(e, &system->cpu->state.IME);
+    emit_bytes(e, (const uint8_t[]){0x83, 0x38, 0x00}, 3); //cmp dword [rax], 0
+    emit_exit_jump(e, 0x85); //jne
+    patch_jump8(e, none_pending);
+}
+
+//Everything for one instruction: pc, ticks, the instruction itself, then the exit checks unless it's the last one
+static void emit_instruction(Emitter* e, JIT* jit, CachedInstruction* instr, uint8_t last) {
+    emit_pc_add(e, instr->fetch_length);
+
+    //Hardware ticks before the instruction runs, same as the interpreter
+    emit_tick(e, instr->cycles);
+
+    if (!emit_native(e, jit, instr)) {
+        emit_bytes(e, (const uint8_t[]){0x4C, 0x89, 0xE7}, 3); //mov rdi, r12
+        emit_call(e, (const void*)instr->handler);
+
+        //Extra cycles (ie, a taken branch)
+        emit_bytes(e, (const uint8_t[]){0x85, 0xC0}, 2); //test eax, eax
+        emit_bytes(e, (const uint8_t[]){0x74, 17}, 2); //jz over the tick below
+        emit_bytes(e, (const uint8_t[]){0x48, 0x89, 0xDF}, 3); //mov rdi, rbx
+        emit_bytes(e, (const uint8_t[]){0x89, 0xC6}, 2); //mov esi, eax
+        emit_call(e, (const void*)tick_hardware);
+    }
+
+    //Nothing to check after the last one, the block is done anyway
+    if (!last)
+        emit_exit_checks(e, jit);
+}
+
+//Switches the pages the next translation goes in between writable and executable, so no page is ever both
+//Returns 0 if mprotect fails
+static uint8_t protect_translation(JIT* jit, int prot) {
+    size_t start = jit->used & ~(jit->page_size - 1);
+    size_t end = (jit->used + JIT_MAX_BLOCK_SIZE + jit->page_size - 1) & ~(jit->page_size - 1);
+
+    if (end > JIT_BUFFER_SIZE)
+        end = JIT_BUFFER_SIZE;
+
+    return mprotect(jit->buffer + start, end - start, prot) == 0;
+}
+
+//Translates a block into native code
+//Returns NULL if the buffer couldn't be made writable/executable
+static void* translate_block(JIT* jit, CachedBlock* block) {
+    if (JIT_BUFFER_SIZE - jit->used < JIT_MAX_BLOCK_SIZE)
+        jit_flush(jit);
+
+    if (!protect_translation(jit, PROT_READ | PROT_WRITE)) {
+        log_message(LOG_LEVEL_ERROR, "Error making JIT memory writable");
+        return NULL;
+    }
+
+    Emitter e = {.start = jit->buffer + jit->used, .ptr = jit->buffer + jit->used, .num_exit_jumps = 0};
+
+    //Prologue. Three pushes keep the stack 16 byte aligned for the calls
+    emit_byte(&e, 0x53); //push rbx
+    emit_bytes(&e, (const uint8_t[]){0x41, 0x54}, 2); //push r12
+    emit_bytes(&e, (const uint8_t[]){0x41, 0x55}, 2); //push r13
+    emit_bytes(&e, (const uint8_t[]){0x48, 0xBB}, 2); //mov rbx, system
+    emit_u64(&e, (uint64_t)(uintptr_t)jit->system);
+    emit_bytes(&e, (const uint8_t[]){0x49, 0xBC}, 2); //mov r12, cpu
+    emit_u64(&e, (uint64_t)(uintptr_t)jit->system->cpu);
+    emit_mov_rax(&e, &jit->cache->generation);
+    emit_bytes(&e, (const uint8_t[]){0x44, 0x8B, 0x28}, 3); //mov r13d, [rax]
+
+    for (int i = 0; i < block->num_instructions; ++i) {
+        //If another instruction might not fit, the translation stops here. The instruction before it already did its
+        //exit checks, so the native code just returns with pc on this one and the interpreter carries on from there
+        if ((size_t)(e.ptr - e.start) + JIT_MAX_INSTRUCTION_SIZE + JIT_EPILOGUE_SIZE > JIT_MAX_BLOCK_SIZE)
+            break;
+
+        uint8_t* instr_start = e.ptr;
+        emit_instruction(&e, jit, &block->instructions[i], i == block->num_instructions - 1);
+
+        //Only the size limit keeps the code inside the writable pages, so an instruction going over it is a bug
+        if ((size_t)(e.ptr - instr_start) > JIT_MAX_INSTRUCTION_SIZE) {
+            log_message(LOG_LEVEL_ERROR, "JIT instruction went over JIT_MAX_INSTRUCTION_SIZE");
+            abort();
+        }
+    }
+
+    //Epilogue, which is also where every exit jump goes
+    uint8_t* exit = e.ptr;
+    emit_bytes(&e, (const uint8_t[]){0x41, 0x5D}, 2); //pop r13
+    emit_bytes(&e, (const uint8_t[]){0x41, 0x5C}, 2); //pop r12
+    emit_byte(&e, 0x5B); //pop rbx
+    emit_byte(&e, 0xC3); //ret
+
+    for (int i = 0; i < e.num_exit_jumps; ++i) {
+        int32_t rel = (int32_t)(exit - (e.exit_jumps[i] + 4));
+        memcpy(e.exit_jumps[i], &rel, 4);
+    }
+
+    //Translations that share these pages can't run until they're executable again, so if that fails none of them can
+    if (!protect_translation(jit, PROT_READ | PROT_EXEC)) {
+        log_message(LOG_LEVEL_ERROR, "Error making JIT memory executable");
+        jit_flush(jit);
+        return NULL;
+    }
+
+    jit->used += (size_t)(e.ptr - e.start);
+    ++jit->translations;
+
+    return e.start;
+}
+
+JIT* jit_init(EmulatorSystem* system) {
+    if (system == NULL || system->block_cache == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error initializing JIT");
+        return NULL;
+    }
+
+    JIT* jit = (JIT*)calloc(1, sizeof(JIT));
+    if (jit == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error initializing JIT");
+        return NULL;
+    }
+
+    //Never writable and executable at the same time. translate_block flips the pages it writes to and back
+    void* buffer = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) {
+        log_message(LOG_LEVEL_ERROR, "Error allocating JIT memory");
+        free(jit);
+        return NULL;
+    }
+
+    jit->system = system;
+    jit->cache = system->block_cache;
+    jit->buffer = (uint8_t*)buffer;
+    jit->page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+    return jit;
+}
+
+void jit_destroy(JIT* jit) {
+    if (jit == NULL)
+        return;
+
+    munmap(jit->buffer, JIT_BUFFER_SIZE);
+    free(jit);
+}
+
+uint8_t jit_run_block(JIT* jit, CachedBlock* block) {
+    //RAM code can change under the block, so that always stays in the interpreter
+    if (block->in_ram)
+        return 0;
+
+    if (block->native == NULL) {
+        //Wait until the block is actually hot before spending time on it
+        if (++block->exec_count < JIT_HOT_THRESHOLD)
+            return 0;
+
+        block->native = translate_block(jit, block);
+        if (block->native == NULL) {
+            block->exec_count = 0;
+            return 0;
+        }
+    }
+
+    ((JitBlockFn)block->native)();
+    ++jit->native_runs;
+
+    return 1;
+}
+
+//Throws away every translation. Only happens when the buffer fills up
+void jit_flush(JIT* jit) {
+    for (int i = 0; i < BLOCK_CACHE_SIZE; ++i) {
+        jit->cache->blocks[i].native = NULL;
+        jit->cache->blocks[i].exec_count = 0;
+    }
+
+    jit->used = 0;
+    ++jit->flushes;
+}
+
+void jit_print_stats(JIT* jit) {
+    printf("JIT: %llu translations, %llu native block runs, %llu flushes, %zu bytes of code\n",
+        (unsigned long long)jit->translations, (unsigned long long)jit->native_runs,
+        (unsigned long long)jit->flushes, jit->used);
+}
+
+#else
+//No JIT on this platform, so everything just runs in the interpreter
+
+JIT* jit_init(EmulatorSystem* system) {
+    log_message(LOG_LEVEL_WARNING, "JIT isn't supported in this build, using the interpreter");
+    return NULL;
+}
+
+void jit_destroy(JIT* jit) {}
+
+uint8_t jit_run_block(JIT* jit, CachedBlock* block) {
+    return 0;
+}
+
+void jit_flush(JIT* jit) {}
+
+void jit_print_stats(JIT* jit) {}
+
+#endif
@@ -1,12 +1,239 @@
 #include <stdio.h>
+#include <string.h>
 #include "logging.h"
 
-//Helper function that will print error IF suppression isnt enabled
-//This is ONLY so my unit tests dont give error messages.
+#if defined(__GNUC__) && !defined(_WIN32)
+    #include <pthread.h>
+    #include <time.h>
+    #define LOG_ASYNC
+#endif
 
-//#define SUPPRESS_ERROR_OUTPUT
-void printError(char* msg) {
-    #ifndef SUPPRESS_ERROR_OUTPUT
-        fprintf(stderr, "%s\n", msg);
-    #endif
-}
\ No newline at end of file
+#define LOG_MESSAGE_SIZE 120
+#define LOG_DRAIN_INTERVAL_MS 20
+
+static const char* level_names[] = { "error", "warning", "info", "debug" };
+
+static LogLevel log_level = LOG_LEVEL_DEFAULT;
+
+//Writes one message to stderr
+static void log_write(LogLevel level, const char* msg, uint32_t hits) {
+    if (hits > LOG_SITE_BURST)
+        fprintf(stderr, "[%s] %s (x%u)\n", level_names[level], msg, hits);
+    else
+        fprintf(stderr, "[%s] %s\n", level_names[level], msg);
+}
+
+#ifdef LOG_ASYNC
+
+/*
+* Ring buffer.
+* Any thread can push without locking: it claims a slot by bumping the head, fills it in, and then publishes it by
+* setting the slot's sequence number. The writer thread takes slots from the tail in order once they're published.
+* If the ring is full the message gets dropped (and counted) instead of waiting.
+*/
+#define LOG_RING_SIZE 256 //Has to be a power of 2
+
+typedef struct {
+    size_t sequence; //Equals the slot's position when it's free, position + 1 once a message is in it
+    LogLevel level;
+    uint32_t hits;
+    char text[LOG_MESSAGE_SIZE];
+} LogSlot;
+
+static LogSlot ring[LOG_RING_SIZE];
+static size_t ring_head; //Next position to push to
+static size_t ring_tail; //Next position to write out. Only touched with drain_lock held
+static uint32_t dropped;
+
+//Writer thread
+static pthread_t writer;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER; //Signalled when the writer should stop
+static uint8_t running;
+static uint8_t stopping;
+
+static void* writer_loop(void* arg);
+static void drain();
+
+uint8_t log_init(LogLevel level) {
+    log_level = level;
+
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        return 0;
+
+    for (size_t i = 0; i < LOG_RING_SIZE; ++i)
+        ring[i].sequence = i;
+
+    ring_head = 0;
+    ring_tail = 0;
+    stopping = 0;
+
+    if (pthread_create(&writer, NULL, writer_loop, NULL) != 0)
+        return 1; //Messages just get written straight away then
+
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void log_shutdown() {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+        return;
+
+    pthread_mutex_lock(&drain_lock);
+    stopping = 1;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&drain_lock);
+
+    pthread_join(writer, NULL);
+
+    //Anything still queued gets written here, and anything after this goes straight to stderr
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    log_flush();
+}
+
+void log_flush() {
+    pthread_mutex_lock(&drain_lock);
+    drain();
+    pthread_mutex_unlock(&drain_lock);
+}
+
+//Counts a hit on a call site, and queues the message if it's one that should be logged
+//site can be NULL for messages that aren't rate limited
+void log_site_hit(LogSite* site, LogLevel level, const char* msg) {
+    if (level > log_level)
+        return;
+
+    uint32_t hits = 1;
+    if (site != NULL) {
+        hits = __atomic_add_fetch(&site->hits, 1, __ATOMIC_RELAXED);
+
+        if (hits > LOG_SITE_BURST && (hits & (hits - 1)) != 0)
+            return;
+    }
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        log_write(level, msg, hits);
+        return;
+    }
+
+    //Claim a slot
+    size_t position = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+    LogSlot* slot;
+
+    for (;;) {
+        slot = &ring[position & (LOG_RING_SIZE - 1)];
+        size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+        if (sequence == position) {
+            if (__atomic_compare_exchange_n(&ring_head, &position, position + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if ((intptr_t)(sequence - position) < 0) {
+            //Still has a message from last time around, so the ring is full
+            __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        else {
+            position = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->level = level;
+    slot->hits = hits;
+    strncpy(slot->text, msg, LOG_MESSAGE_SIZE - 1);
+    slot->text[LOG_MESSAGE_SIZE - 1] = '\0';
+
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+//Writes out every published message. drain_lock has to be held
+static void drain() {
+    for (;;) {
+        LogSlot* slot = &ring[ring_tail & (LOG_RING_SIZE - 1)];
+
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != ring_tail + 1)
+            break;
+
+        log_write(slot->level, slot->text, slot->hits);
+
+        //Frees the slot for the next time around
+        __atomic_store_n(&slot->sequence, ring_tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        ++ring_tail;
+    }
+
+    uint32_t lost = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+    if (lost != 0)
+        fprintf(stderr, "[warning] %u log messages dropped\n", lost);
+}
+
+//Writes whatever's queued every LOG_DRAIN_INTERVAL_MS until it's told to stop
+static void* writer_loop(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&drain_lock);
+
+    while (!stopping) {
+        drain();
+
+        struct timespec wake_time;
+        clock_gettime(CLOCK_REALTIME, &wake_time);
+        wake_time.tv_nsec += (long)LOG_DRAIN_INTERVAL_MS * 1000000;
+        if (wake_time.tv_nsec >= 1000000000) {
+            wake_time.tv_nsec -= 1000000000;
+            ++wake_time.tv_sec;
+        }
+
+        pthread_cond_timedwait(&wake, &drain_lock, &wake_time);
+    }
+
+    pthread_mutex_unlock(&drain_lock);
+    return NULL;
+}
+
+#else
+
+//No threads here, so everything just gets written straight away
+uint8_t log_init(LogLevel level) {
+    log_level = level;
+    return 0;
+}
+
+void log_shutdown() {
+    fflush(stderr);
+}
+
+void log_flush() {
+    fflush(stderr);
+}
+
+void log_site_hit(LogSite* site, LogLevel level, const char* msg) {
+    if (level > log_level)
+        return;
+
+    uint32_t hits = 1;
+    if (site != NULL) {
+        hits = ++site->hits;
+
+        if (hits > LOG_SITE_BURST && (hits & (hits - 1)) != 0)
+            return;
+    }
+
+    log_write(level, msg, hits);
+}
+
+#endif
+
+void log_message(LogLevel level, const char* msg) {
+    log_site_hit(NULL, level, msg);
+}
+
+uint8_t log_parse_level(const char* name, LogLevel* level) {
+    for (int i = 0; i < (int)(sizeof(level_names) / sizeof(level_names[0])); ++i) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (LogLevel)i;
+            return 0;
+        }
+    }
+
+    return 1;
+}
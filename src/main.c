@@ -1,14 +1,26 @@
 #include "init.h"
 #include "logging.h"
 
-//Simply initializes current emulator for now..
-int main() {
-    int success = emulator_init();
+//Reads the command line options and initializes the emulator
+int main(int argc, char** argv) {
+    EmulatorOptions options;
+    if (parse_options(argc, argv, &options) == 1) {
+        print_usage();
+        return 1;
+    }
+
+    log_init(options.log_level);
+
+    int success = emulator_init(&options);
 
-    if (success == 1) {
-        printError("Initialization failed");
+    if (success == 1)
+        log_message(LOG_LEVEL_ERROR, "Initialization failed");
+
+    //Writes out anything still queued before waiting on the user
+    log_shutdown();
+
+    if (success == 1)
         getchar();
-    }
 
     return success;
-}
\ No newline at end of file
+}
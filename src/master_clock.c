@@ -12,85 +12,223 @@
 #define TAC_CLOCK_SELECT 0x3 //Bottom 2 bits select TAC clock value
 #define TAC_ENABLE 0x4 //Bit 2 is TAC enable
 
-//Iniital values for system clock
-MasterClock* master_clock_init(GlobalTimerState* global_state) {
-    if (global_state == NULL) {
-        printError("Unable to initialize system clock.");
-        return NULL;
-    }
-
-	MasterClock* sys_clock = (MasterClock*)malloc(sizeof(MasterClock));
+static void timer_tick(GlobalTimerState* timer, Memory* mem, uint64_t time);
+static uint64_t timer_next_reload(GlobalTimerState* timer, Memory* mem);
 
-    if (sys_clock == NULL) {
-        printError("Unable to initialize system clock.");
+//Iniital values for system clock
+MasterClock* master_clock_init(MasterClock* sys_clock, GlobalTimerState* global_state) {
+    if (sys_clock == NULL || global_state == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Unable to initialize system clock.");
         return NULL;
     }
 
     sys_clock->global_state = global_state;
-    
-    sys_clock->local_state.prev_tac_bit = 0; //Stores what the last Timer Control bit was for updating TIMA
-    sys_clock->local_state.prev_tma_val = 0; //Stores previous M-Cycle's TMA value for TIMA overflow
-    sys_clock->local_state.tima_overflow = 0; //Flag to check whether TIMA overflowed
-    sys_clock->local_state.tima_overflow_buffer = 0; //Flag to check if TIMA overflowed 2 cycles ago for TIMA updates
 
     return sys_clock;
 }
 
-void master_clock_destroy(MasterClock* clock) {
-    if (clock != NULL)
-        free(clock);
-}
-
-//Updates timer registers
-void update_timing_registers(MasterClock* clock, Memory* mem) {
-    uint16_t start_time = clock->global_state->system_time;
-
-    //DIV reflects bottom 8 bits of system time
-    uint8_t div = (uint8_t)((start_time) >> 8);
-    mem->DIV_LOCATION = div; //0xFF04 = DIV
-
-    //Update TIMA
-    //Updates when specific bit in DIV goes from 1 to 0. The bit is specified by TAC
-    uint8_t tac_value = mem->TAC_LOCATION; //TAC at 0xFF07
-    uint8_t tac_bit_pos = 0; //Which bit of system clock is being checked
+//Gets bit of the system clock that TIMA is looking for
+uint8_t get_tac_bit_pos(uint8_t tac_value) {
     uint8_t tac_bit_select = (tac_value & TAC_CLOCK_SELECT);
 
-    //Gets bit that TIMA is looking for
     if (tac_bit_select == 0x0)
-        tac_bit_pos = 9; //Increments every (2^9) * 2 t-cycles
+        return 9; //Increments every (2^9) * 2 t-cycles
     else if (tac_bit_select == 0x01)
-        tac_bit_pos = 3; //Increments every (2^3) * 2 t-cycles
+        return 3; //Increments every (2^3) * 2 t-cycles
     else if (tac_bit_select == 0x02)
-        tac_bit_pos = 5; //Increments every (2^5) * 2 t-cycles
-    else if (tac_bit_select == 0x03)
-        tac_bit_pos = 7; //Increments every (2^7) * 2 t-cycles
+        return 5; //Increments every (2^5) * 2 t-cycles
+    else
+        return 7; //Increments every (2^7) * 2 t-cycles
+}
+
+//Updates the timer registers for one tick, the same way they'd get updated if it went tick by tick
+static void timer_tick(GlobalTimerState* timer, Memory* mem, uint64_t time) {
+    //Update TIMA
+    //Updates when specific bit in DIV goes from 1 to 0. The bit is specified by TAC
+    uint8_t tac_value = mem->TAC_LOCATION; //TAC at 0xFF07
+    uint8_t tac_bit_pos = get_tac_bit_pos(tac_value); //Which bit of system clock is being checked
 
-    uint8_t tac_bit = GET_BIT(start_time, tac_bit_pos);
-    uint8_t prev_tac_bit = clock->local_state.prev_tac_bit; //Previous value of TAC
+    uint8_t tac_bit = GET_BIT(timer_system_time(timer, time), tac_bit_pos);
 
     //If TIMA overflowed on the previous cycle, request the interrupt now
-    if (clock->local_state.tima_overflow) {
-        clock->local_state.tima_overflow = 0;
+    if (timer->tima_overflow) {
+        timer->tima_overflow = 0;
         //If TIMA gets written to, the overflow gets ignored
         if (mem->TIMA_LOCATION == 0) {
-            clock->local_state.tima_overflow_buffer = 1;
             requestInterrupt(INTERRUPT_TIMER, mem);
             mem->TIMA_LOCATION = mem->TMA_LOCATION; //Resest TIMA to TMA
         }
     }
 
     //If bit went from 1 to 0 and TIMA is enabled..
-    if (prev_tac_bit == 1 && tac_bit == 0 && GET_BIT(tac_value, 2)) {
+    if (timer->prev_tac_bit == 1 && tac_bit == 0 && GET_BIT(tac_value, 2)) {
         ++mem->TIMA_LOCATION; //Increment TIMA (0xFF05)
 
         //If there was an overflow...
         if (mem->TIMA_LOCATION == 0x00) {
             //Sets flag that TIMA overflowed. This means that TIMA remains 0
             //during this m-cycle (correct behavior!!)
-            clock->local_state.tima_overflow = 1;
+            timer->tima_overflow = 1;
         }
     }
 
     //Update previous TAC bit value
-    clock->local_state.prev_tac_bit = tac_bit;
-}
\ No newline at end of file
+    timer->prev_tac_bit = tac_bit;
+}
+
+//Brings DIV and TIMA up to date for every tick before time
+void timer_catch_up(GlobalTimerState* timer, Memory* mem, uint64_t time) {
+    if (time <= timer->synced_time)
+        return;
+
+    //TAC can only change through a write, which catches up first, so it's the same the whole way
+    uint8_t tac_value = mem->TAC_LOCATION;
+    uint8_t tac_bit_pos = get_tac_bit_pos(tac_value);
+    uint32_t period = 1u << (tac_bit_pos + 1);
+    uint64_t tick = timer->synced_time;
+
+    //First tick goes the slow way, since DIV or TAC could have just been written, which can increment TIMA
+    timer_tick(timer, mem, tick++);
+
+    while (tick < time) {
+        //Reload after an overflow
+        if (timer->tima_overflow) {
+            timer_tick(timer, mem, tick++);
+            continue;
+        }
+
+        if (!(tac_value & TAC_ENABLE))
+            break;
+
+        //After the first tick, TIMA goes up whenever the system time hits a multiple of the period
+        uint16_t system_time = timer_system_time(timer, tick);
+        uint64_t next_increment = tick + ((period - (system_time & (period - 1))) & (period - 1));
+        if (next_increment >= time)
+            break;
+
+        uint64_t increments = (time - 1 - next_increment) / period + 1;
+        uint32_t until_overflow = 0x100 - mem->TIMA_LOCATION;
+
+        if (increments < until_overflow) {
+            mem->TIMA_LOCATION += (uint8_t)increments;
+            break;
+        }
+
+        //Skip straight to the increment that overflows
+        mem->TIMA_LOCATION = 0;
+        timer->tima_overflow = 1;
+        timer->prev_tac_bit = 0; //Bit just went to 0
+        tick = next_increment + (uint64_t)(until_overflow - 1) * period + 1;
+    }
+
+    //DIV reflects the top 8 bits of system time
+    uint16_t last_time = timer_system_time(timer, time - 1);
+    mem->DIV_LOCATION = (uint8_t)(last_time >> 8);
+    timer->prev_tac_bit = GET_BIT(last_time, tac_bit_pos);
+    timer->synced_time = time;
+}
+
+//Tick TIMA gets reloaded on after the next overflow (which is when the interrupt gets requested), or SCHEDULER_NEVER
+//if the timer is off. Timer has to be caught up first
+static uint64_t timer_next_reload(GlobalTimerState* timer, Memory* mem) {
+    uint64_t now = timer->synced_time;
+
+    //Overflow is about to reload TIMA
+    if (timer->tima_overflow)
+        return now;
+
+    //TIMA doesn't move at all if the timer is off
+    uint8_t tac_value = mem->TAC_LOCATION;
+    if (!(tac_value & TAC_ENABLE))
+        return SCHEDULER_NEVER;
+
+    //TIMA goes up when the TAC bit goes from 1 to 0, which happens whenever the system time hits a multiple of 2^(bit+1)
+    uint8_t tac_bit_pos = get_tac_bit_pos(tac_value);
+    uint32_t period = 1u << (tac_bit_pos + 1);
+    uint16_t system_time = timer_system_time(timer, now);
+    uint64_t next_increment = now + period - (system_time & (period - 1));
+    uint32_t increments_left = 0xFF - mem->TIMA_LOCATION; //Increments after the next one before TIMA wraps
+
+    //Edge is on the very next tick too (this also catches TAC being switched to a bit that's already 0)
+    if (timer->prev_tac_bit && !((system_time >> tac_bit_pos) & 0x1)) {
+        if (increments_left == 0)
+            return now + 1;
+
+        --increments_left;
+    }
+
+    //The increment that wraps TIMA to 0 only reloads it on the tick after
+    return next_increment + (uint64_t)increments_left * period + 1;
+}
+
+//Posts the next TIMA reload. Timer has to be caught up first
+void timer_post_overflow(GlobalTimerState* timer, Memory* mem, Scheduler* scheduler) {
+    uint64_t reload_time = timer_next_reload(timer, mem);
+
+    if (reload_time == SCHEDULER_NEVER)
+        scheduler_cancel(scheduler, EVENT_TIMER);
+    else
+        scheduler_post(scheduler, EVENT_TIMER, reload_time);
+}
+
+//Reloads TIMA (and requests the interrupt) and then posts the next overflow
+void timer_event(GlobalTimerState* timer, Memory* mem, Scheduler* scheduler, uint64_t time) {
+    timer_catch_up(timer, mem, time + 1);
+    timer_post_overflow(timer, mem, scheduler);
+}
+
+//Number of upcoming ticks that leave DIV the same
+uint32_t timer_ticks_until_div_change(MasterClock* clock, Memory* mem) {
+    GlobalTimerState* timer = clock->global_state;
+    timer_catch_up(timer, mem, timer->elapsed_time);
+
+    uint16_t system_time = timer_system_time(timer, timer->elapsed_time);
+
+    //Next tick writes DIV from the current system time, so if that's already different it changes right away
+    if ((uint8_t)(system_time >> 8) != mem->DIV_LOCATION)
+        return 0;
+
+    return 0x100 - (system_time & 0xFF);
+}
+
+//Number of upcoming ticks that leave TIMA (and the timer interrupt) the same
+uint32_t timer_ticks_until_tima_change(MasterClock* clock, Memory* mem) {
+    GlobalTimerState* timer = clock->global_state;
+    timer_catch_up(timer, mem, timer->elapsed_time);
+
+    //Overflow is about to reload TIMA
+    if (timer->tima_overflow)
+        return 0;
+
+    //TIMA doesn't move at all if the timer is off
+    if (!(mem->TAC_LOCATION & TAC_ENABLE))
+        return UINT32_MAX;
+
+    //TIMA goes up when the TAC bit goes from 1 to 0, which happens whenever the system time hits a multiple of 2^(bit+1)
+    uint8_t tac_bit_pos = get_tac_bit_pos(mem->TAC_LOCATION);
+    uint32_t period = 1u << (tac_bit_pos + 1);
+    uint16_t system_time = timer_system_time(timer, timer->elapsed_time);
+    uint32_t remainder = system_time % period;
+
+    //Edge is on the very next tick (this also catches TAC being switched to a bit that's already 0)
+    uint8_t tac_bit = (system_time >> tac_bit_pos) & 0x1;
+    if (timer->prev_tac_bit && !tac_bit)
+        return 0;
+
+    if (remainder == 0)
+        return period;
+
+    return period - remainder;
+}
+
+//Number of upcoming ticks that go by without the timer requesting an interrupt
+uint32_t timer_ticks_until_overflow(MasterClock* clock, Memory* mem) {
+    GlobalTimerState* timer = clock->global_state;
+    timer_catch_up(timer, mem, timer->elapsed_time);
+
+    uint64_t reload_time = timer_next_reload(timer, mem);
+    if (reload_time == SCHEDULER_NEVER || reload_time - timer->elapsed_time > UINT32_MAX)
+        return UINT32_MAX;
+
+    return (uint32_t)(reload_time - timer->elapsed_time);
+}
@@ -6,16 +6,26 @@
 MBC_Type getMBCType(uint8_t type);
 uint8_t getNumRAMBanks(uint8_t ram);
 
-MBC* mbc_init(MBC_Data* mbc_data) {
-    if (mbc_data == NULL) {
-        printError("Error intializing MBC");
-        return NULL;
-    }
-
-    MBC* mbc = (MBC*)malloc(sizeof(MBC));
-
-    if (mbc == NULL) {
-        printError("Error initialzing MBC");
+//Interface functions shared between MBCs
+static void mbc_none_write(MBC* mbc, uint16_t address, uint8_t value);
+static void update_banks_default(MBC* mbc);
+static void update_mbc1_banks(MBC* mbc);
+static void update_mbc3_banks(MBC* mbc);
+static uint8_t load_mbc3(MBC* mbc, FILE* save_file);
+static size_t save_mbc3(MBC* mbc, uint8_t* data);
+static uint8_t load_nothing(MBC* mbc, FILE* save_file);
+static size_t save_nothing(MBC* mbc, uint8_t* data);
+
+static const MBC_Interface mbc_none_interface = { mbc_none_write, update_banks_default, load_nothing, save_nothing };
+static const MBC_Interface mbc1_interface = { update_mbc1_data, update_mbc1_banks, load_nothing, save_nothing };
+static const MBC_Interface mbc2_interface = { update_mbc2_data, update_banks_default, load_nothing, save_nothing };
+static const MBC_Interface mbc3_interface = { update_mbc3_data, update_mbc3_banks, load_mbc3, save_mbc3 };
+static const MBC_Interface mbc5_interface = { update_mbc5_data, update_banks_default, load_nothing, save_nothing };
+
+//Sets up the MBC in place. Whoever owns it owns mbc_data too
+MBC* mbc_init(MBC* mbc, MBC_Data* mbc_data) {
+    if (mbc == NULL || mbc_data == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error intializing MBC");
         return NULL;
     }
 
@@ -36,6 +46,15 @@ MBC* mbc_init(MBC_Data* mbc_data) {
     mbc->has_battery = 0;
     mbc->has_rtc = 0;
 
+    //Memory gets set later with mbc_set_memory, once it's been allocated
+    mbc->rom = NULL;
+    mbc->exram = NULL;
+    mbc->rom_bank_0 = NULL;
+    mbc->rom_bank_x = NULL;
+    mbc->exram_bank = NULL;
+    mbc->rtc_select = 0;
+    rtc_init(&mbc->rtc);
+
     /*
      * Get general MBC Information
      */
@@ -45,17 +64,19 @@ MBC* mbc_init(MBC_Data* mbc_data) {
     uint8_t ram_byte = mbc_data->mbc_ram_size_byte;
 
     //Battery MBCs
-    if (type_byte == 0x3 || type_byte == 0x6 || type_byte == 0xF ||
-        type_byte == 0x1B || type_byte == 0x1E)
+    if (type_byte == 0x3 || type_byte == 0x6 || type_byte == 0xF || type_byte == 0x10 ||
+        type_byte == 0x13 || type_byte == 0x1B || type_byte == 0x1E)
         mbc->has_battery = 1;
 
     //RTC MBCs
-    if (type_byte == 0xF)
+    if (type_byte == 0xF || type_byte == 0x10)
         mbc->has_rtc = 1;
 
     //ROM and EXRAM banks
     mbc->num_rom_banks = 2 << rom_byte; //2^(rom_byte + 1)
     mbc->num_exram_banks = getNumRAMBanks(ram_byte);
+    mbc->exram_size = mbc_exram_size(mbc_data);
+    mbc->exram_mask = EXRAM_WINDOW_MASK;
 
     /*
      * MBC Specific values
@@ -66,6 +87,7 @@ MBC* mbc_init(MBC_Data* mbc_data) {
             //Since no MBC has no bank switching, there is always just bank 0 and 1, and the area for the switchable bank is just static
             mbc->current_rom_bank = 1;
             if (mbc->num_exram_banks > 0) { mbc->exram_enabled = 1; } //SOME no mbc cartridges have RAM, in which case it is just static addresses
+            mbc->interface = &mbc_none_interface;
             break;
 
         case MBC_1:
@@ -74,55 +96,128 @@ MBC* mbc_init(MBC_Data* mbc_data) {
             mbc->has_mode_switch = 1;
             mbc->mbc_mode = 0; //MBC1 specific. Starts at 0 by default
             mbc->current_rom_bank = 1; //MBC1 treats bank 0 as 1, so this starts at 1
+            mbc->interface = &mbc1_interface;
             break;
 
-        default:
+        case MBC_2:
+            //MBC2 has 0x200 addresses for RAM access, regardless of what the header says
+            mbc->exram_mask = 0x1FF;
+            mbc->interface = &mbc2_interface;
+            break;
+
+        case MBC_3:
+            mbc->interface = &mbc3_interface;
+            break;
+
+        case MBC_5:
+            mbc->interface = &mbc5_interface;
             break;
     }
 
     return mbc;
 }
 
-//Frees MBC memory
-void mbc_destroy(MBC* mbc) {
-    if (mbc == NULL)
-        return;
-    
-    if (mbc->mbc_data != NULL)
-        free(mbc->mbc_data);
+//Bytes of EXRAM a cartridge has, straight from the header
+//This is separate so memory can be sized before the MBC is set up
+uint32_t mbc_exram_size(const MBC_Data* mbc_data) {
+    //MBC2 has 0x200 addresses for RAM access, regardless of what the header says
+    if (mbc_data->mbc_type_byte == 0x05 || mbc_data->mbc_type_byte == 0x06)
+        return 0x200;
 
-    free(mbc);
+    return (uint32_t)getNumRAMBanks(mbc_data->mbc_ram_size_byte) * 0x2000;
 }
 
-//Updates MBC information with address and values written to
-void update_current_bank(MBC* mbc, uint16_t address, uint8_t value) {
-    //Dispatch function that will handle each case individually. This allows
-    //for more scalability if I add more down the line, or if I miss some weird quirks
+//Gives the MBC the memory its banks are in and sets up the bank pointers
+//EXRAM can be NULL if the cartridge doesn't have any
+void mbc_set_memory(MBC* mbc, uint8_t* rom, uint8_t* exram) {
+    mbc->rom = rom;
+    mbc->exram = exram;
 
-    //It feels kind of messy to have to just have different functions for each of these, 
-    //but these MBC chips are literally just wired differently, so there's no clean solution other than
-    //encapsulate each one individually.
-    switch(mbc->mbc_type) {
-        case MBC_NONE:
-            break; //Do nothing here
-        case MBC_1:
-            update_mbc1_data(mbc, address, value);
-            break;
-        case MBC_2:
-            update_mbc2_data(mbc, address, value);
-            break;
-        case MBC_3:
-            update_mbc3_data(mbc, address, value);
-            break;
-        case MBC_5:
-            update_mbc5_data(mbc, address, value);
-            break;
+    if (exram == NULL)
+        mbc->exram_size = 0;
+
+    mbc->interface->update_banks(mbc);
+}
+
+//It feels kind of messy to have to just have different functions for each of these, 
+//but these MBC chips are literally just wired differently, so there's no clean solution other than
+//encapsulate each one individually.
+
+//No MBC means nothing to switch, so writes here do nothing
+static void mbc_none_write(MBC* mbc, uint16_t address, uint8_t value) {
+    (void)mbc;
+    (void)address;
+    (void)value;
+}
+
+//Bank pointers for everything but MBC1, where bank 0 is always just bank 0
+static void update_banks_default(MBC* mbc) {
+    if (mbc->rom != NULL) {
+        mbc->rom_bank_0 = mbc->rom;
+        mbc->rom_bank_x = &mbc->rom[(uint32_t)mbc->current_rom_bank * 0x4000];
+    }
+
+    //Wraps around if the bank is past the end of EXRAM
+    mbc->exram_bank = NULL;
+    if (mbc->exram != NULL && mbc->exram_size != 0)
+        mbc->exram_bank = &mbc->exram[((uint32_t)mbc->current_exram_bank * 0x2000) % mbc->exram_size];
+}
+
+//MBC1 in mode 1 also switches the bank at 0x0000-0x3FFF, using the BANK2 bits
+static void update_mbc1_banks(MBC* mbc) {
+    update_banks_default(mbc);
+
+    if (mbc->rom != NULL && mbc->mbc_mode == 1)
+        mbc->rom_bank_0 = &mbc->rom[(uint32_t)(mbc->current_rom_bank & ~0x9F) * 0x4000];
+}
+
+//MBC3 maps a single RTC register over the whole EXRAM window when one is selected
+static void update_mbc3_banks(MBC* mbc) {
+    update_banks_default(mbc);
+    mbc->exram_mask = EXRAM_WINDOW_MASK;
+
+    if (mbc->rtc_select != 0) {
+        mbc->exram_bank = &mbc->rtc.latched[mbc->rtc_select - RTC_SECONDS];
+        mbc->exram_mask = 0;
     }
 }
 
+//Battery backed EXRAM is the whole save for most cartridges
+static uint8_t load_nothing(MBC* mbc, FILE* save_file) {
+    (void)mbc;
+    (void)save_file;
+    return 0;
+}
+
+static size_t save_nothing(MBC* mbc, uint8_t* data) {
+    (void)mbc;
+    (void)data;
+    return 0;
+}
+
+//MBC3 saves have the clock after the EXRAM (if there is any)
+static uint8_t load_mbc3(MBC* mbc, FILE* save_file) {
+    if (mbc->has_rtc)
+        rtc_load(&mbc->rtc, save_file); //Saves without a clock are fine, it just starts at 0
+
+    return 0;
+}
+
+static size_t save_mbc3(MBC* mbc, uint8_t* data) {
+    if (!mbc->has_rtc)
+        return 0;
+
+    rtc_save(&mbc->rtc, data);
+    return RTC_SAVE_SIZE;
+}
+
 
 //Specific MBC update information...
 void update_mbc1_data(MBC* mbc, uint16_t address, uint8_t value) {
+    //EXRAM window writes get here too, but there aren't any registers there
+    if (address >= 0x8000)
+        return;
+
     /*
     * Each MBC has a range of addresses that will change the state of the MBC.
     * So the register doesn't get updated from a specific write, but a range.
@@ -188,9 +283,15 @@ void update_mbc1_data(MBC* mbc, uint16_t address, uint8_t value) {
             mbc->mbc_mode = value & 0x01; //Lowest bit sets this
         }
     }
+
+    mbc->interface->update_banks(mbc);
 }
 
 void update_mbc2_data(MBC* mbc, uint16_t address, uint8_t value) {
+    //EXRAM window writes get here too, but there aren't any registers there
+    if (address >= 0x8000)
+        return;
+
     if (address <= 0x3FFF) {
         //Depending on bit 8 of the address, this is either the RAM enable register,
         //or the ROM bank register
@@ -213,19 +314,60 @@ void update_mbc2_data(MBC* mbc, uint16_t address, uint8_t value) {
         }
 
     }
+
+    mbc->interface->update_banks(mbc);
 }
 
-//TODO: Implement this
-//The logic with the RTC is so weirdly complex that I would like to just come
-//back to this later. I will need more stupid structs and logic but whatever man
-//that's just how it works with hardware.
+//The RTC itself is in rtc.c, this just handles the registers that get to it
 void update_mbc3_data(MBC* mbc, uint16_t address, uint8_t value) {
+    //RAM and timer enable register
+    if (address <= 0x1FFF) {
+        mbc->exram_enabled = (value & 0x0F) == 0x0A;
+    }
+
+    //ROM bank select. All 7 bits at once, and 0 still gets treated as 1
+    else if (address <= 0x3FFF) {
+        uint16_t bank = value & 0x7F;
+        if (bank == 0)
+            bank = 1;
+
+        mbc->current_rom_bank = bank % mbc->num_rom_banks;
+    }
+
+    //RAM bank or RTC register select
+    else if (address <= 0x5FFF) {
+        if (value <= 0x07) {
+            mbc->current_exram_bank = value;
+            mbc->rtc_select = 0;
+        }
+        else if (value >= RTC_SECONDS && value <= RTC_DAY_HIGH && mbc->has_rtc)
+            mbc->rtc_select = value;
+    }
 
+    //Latch clock data
+    else if (address <= 0x7FFF) {
+        if (mbc->has_rtc)
+            rtc_latch_write(&mbc->rtc, value);
+    }
+
+    //Writes to the EXRAM window set the selected RTC register
+    else if (address >= 0xA000 && address <= 0xBFFF) {
+        if (mbc->rtc_select != 0 && mbc->exram_enabled)
+            rtc_write(&mbc->rtc, (RTC_Register)mbc->rtc_select, value);
+
+        return; //Doesn't change any banks
+    }
+
+    mbc->interface->update_banks(mbc);
 }
 
 void update_mbc5_data(MBC* mbc, uint16_t address, uint8_t value) {
     //Genuinely the most straightforward one
 
+    //EXRAM window writes get here too, but there aren't any registers there
+    if (address >= 0x8000)
+        return;
+
     //RAM Enable register
     if (address <= 0x1FFF) {
         mbc->exram_enabled = (value & 0x0F) == 0x0A;
@@ -249,6 +391,8 @@ void update_mbc5_data(MBC* mbc, uint16_t address, uint8_t value) {
     else if (address <= 0x5FFF) {
         mbc->current_exram_bank = value & 0x0F;
     }
+
+    mbc->interface->update_banks(mbc);
 }
 
 
@@ -284,7 +428,7 @@ MBC_Type getMBCType(uint8_t type) {
         return MBC_5;
 
     //Anything else is incompatible
-    printError("Unsupported MBC Type! ROM incompatible");
+    log_message(LOG_LEVEL_ERROR, "Unsupported MBC Type! ROM incompatible");
     return MBC_NONE;
 }
 
@@ -6,6 +6,9 @@
 #include "logging.h"
 #include "hardware_registers.h"
 #include "mbc_handler.h"
+#include "rom_image.h"
+#include "save_file.h"
+#include "arena.h"
 
 //Checks which system emulator is compiled on
 //This is only to create a new directory for save data if it doesnt exist
@@ -18,72 +21,117 @@
     #define MAKE_SAVE_DIR(SAVE_DIR) mkdir(SAVE_DIR, 0777)
 #endif
 
+#define MEMORY_REGION_ALIGNMENT 64 //Bigger regions start on their own cache line
+#define MEMORY_HOT_SIZE (0x80 + 0x80 + 0xA0) //IO, HRAM and OAM, which all go together
+#define GAME_NAME_SIZE 17 //16 characters and the NULL
+
+//Helper functions
+static size_t memory_arena_size(size_t exram_size, size_t boot_rom_size, size_t system_size);
+static long get_file_size(FILE* file);
+
 //TODO: Finish this
-Memory* memory_init(FILE* rom_file, FILE* boot_rom_file) {
+Memory* memory_init(FILE* rom_file, FILE* boot_rom_file, size_t system_size) {
     if (rom_file == NULL) {
-        printError("Error opening ROM");
+        log_message(LOG_LEVEL_ERROR, "Error opening ROM");
         return NULL;
     }
 
-    Memory* mem = (Memory*)malloc(sizeof(Memory));
-    if (mem == NULL) {
-        printError("Error freeing space for ROM data");
+    //Everything memory owns goes in one arena, which gets sized from the cartridge header (and boot ROM) first.
+    //The rest of the machine gets carved out of the same one afterwards
+    MBC_Data header;
+    if (get_mbc_data(rom_file, &header)) {
+        log_message(LOG_LEVEL_ERROR, "Error initalizing MBC");
         return NULL;
     }
 
-    MBC* mbc_chip = mbc_init(get_mbc_data(rom_file));
-    
-    //If MBC Chip is NULL, can't do much so return
-    if (mbc_chip == NULL) {
-        free(mem);
+    size_t exram_size = mbc_exram_size(&header);
+    size_t boot_rom_size = (boot_rom_file != NULL) ? (size_t)get_file_size(boot_rom_file) : 0;
+
+    Arena arena;
+    if (arena_init(&arena, memory_arena_size(exram_size, boot_rom_size, system_size))) {
+        log_message(LOG_LEVEL_ERROR, "Error freeing space for ROM data");
         return NULL;
     }
 
-    mem->mbc_chip = mbc_chip;
+    //Memory struct itself is the first thing in there, and keeps the arena
+    Memory* mem = (Memory*)arena_alloc(&arena, sizeof(Memory), MEMORY_REGION_ALIGNMENT);
+    mem->arena = arena;
 
     //Setup Memory Arrays
     //Fixed memory locations
 
-    mem->vram_0 = (uint8_t*)calloc(0x2000, 1); //8kb vram bank. CGB has a second vram bank.
-    mem->wram_x = (uint8_t*)calloc(0x2000, 1); //DMG has 2 fixed banks, CBG has 1 fixed and 7 switchable
-    mem->oam = (uint8_t*)calloc(0xA0, 1); //Object Attribute Memory
-    mem->io = (uint8_t*)calloc(0x80, 1); //IO registers
-    mem->hram = (uint8_t*)calloc(0x80, 1); //hram. Final index is the interrupt enable register.
+    //IO, HRAM and OAM are the ones that get touched the most, so they sit right next to each other
+    uint8_t* hot = (uint8_t*)arena_alloc(&mem->arena, MEMORY_HOT_SIZE, MEMORY_REGION_ALIGNMENT);
+    mem->io = hot; //IO registers
+    mem->hram = hot + 0x80; //hram. Final index is the interrupt enable register.
+    mem->oam = hot + 0x100; //Object Attribute Memory
 
-    //Switchable bank locations
-    mem->rom_x = (uint8_t*)calloc(mbc_chip->num_rom_banks * 0x4000, 1); //ROM always has at least 1 of these, typically 2
-    mem->exram_x = NULL; //There may be no exram
+    mem->vram_0 = (uint8_t*)arena_alloc(&mem->arena, 0x2000, MEMORY_REGION_ALIGNMENT); //8kb vram bank. CGB has a second vram bank.
+    mem->wram_x = (uint8_t*)arena_alloc(&mem->arena, 0x2000, MEMORY_REGION_ALIGNMENT); //DMG has 2 fixed banks, CBG has 1 fixed and 7 switchable
+
+    //MBC Chip
+    MBC_Data* mbc_data = (MBC_Data*)arena_alloc(&mem->arena, sizeof(MBC_Data), ARENA_ALIGNMENT);
+    *mbc_data = header;
+    MBC* mbc_chip = mbc_init((MBC*)arena_alloc(&mem->arena, sizeof(MBC), ARENA_ALIGNMENT), mbc_data);
+    
+    //If MBC Chip is NULL, can't do much so return
+    if (mbc_chip == NULL) {
+        memory_destroy(mem);
+        return NULL;
+    }
 
-    //MBC2 has 0x200 addresses for RAM access. Weird edge case, but yes
-    if (mbc_chip->mbc_type == MBC_2)
-        mem->exram_x = (uint8_t*)calloc(0x200, 1);
-    else if (mbc_chip->num_exram_banks != 0)
-        mem->exram_x = (uint8_t*)calloc(mbc_chip->num_exram_banks * 0x2000, 1); //If MBC is not 2, and there are ram banks, initialize
+    mem->mbc_chip = mbc_chip;
 
-    //Load ROM data
-    load_rom_data(mem, rom_file);
+    //Switchable bank locations
+    //ROM is never written, so it's mapped straight from the file (and shared with anything else running the same ROM)
+    mem->rom_image = rom_image_acquire(rom_file, (size_t)mbc_chip->num_rom_banks * 0x4000); //ROM always has at least 1 of these, typically 2
+    mem->rom_x = (mem->rom_image != NULL) ? (uint8_t*)mem->rom_image->data : NULL;
+    mem->exram_x = NULL; //There may be no exram
+    mem->save_file = NULL;
+    mem->save_in_use = 0;
 
     //Gets game name
     get_game_name(mem);
 
+    //MBC knows how much EXRAM there is (MBC2 has 0x200 addresses for RAM access. Weird edge case, but yes)
+    if (mbc_chip->exram_size != 0) {
+        //Battery backed EXRAM is mapped straight from the save file, so it's saved as soon as it's written
+        if (mbc_chip->has_battery && mem->rom_x != NULL) {
+            char file_path[100];
+            get_save_path(mem, file_path);
+
+            MAKE_SAVE_DIR("saves");
+            mem->save_file = save_file_open(file_path, mbc_chip->exram_size, &mem->save_in_use);
+
+            //Still loads what's there, it just runs from its own copy
+            if (mem->save_in_use)
+                log_message(LOG_LEVEL_WARNING, "Save file is being used by another emulator, this one won't be saved");
+        }
+
+        if (mem->save_file != NULL)
+            mem->exram_x = save_file_data(mem->save_file);
+        else
+            mem->exram_x = (uint8_t*)arena_alloc(&mem->arena, mbc_chip->exram_size, MEMORY_REGION_ALIGNMENT);
+    }
+
+    //MBC works out where the current banks are from here on
+    mbc_set_memory(mbc_chip, mem->rom_x, mem->exram_x);
+
     //Loads save data if it exists
-    if (mbc_chip->has_battery) { load_save_data(mem); } //Load save data if save data exists and game supports it
+    if (mbc_chip->has_battery && mem->rom_x != NULL) { load_save_data(mem); } //Load save data if save data exists and game supports it
 
     //Check for boot rom
     //TODO: Boot ROM is currently very buggy and I'm not sure why?
     
     //If boot rom is NULL, leave it unmapped
-    if (boot_rom_file == NULL) {
-        mem->boot_rom_size = 0;
-        mem->boot_rom = NULL;
-        mem->local_state.boot_rom_mapped = 0;
-    }
-    else {
-        //Load boot ROM. If load fails, free the space it was allocating and keep it disabled
-        if (load_boot_rom_data(mem, boot_rom_file)) {
-            if (mem->boot_rom != NULL) 
-                free(mem->boot_rom);
+    mem->boot_rom_size = 0;
+    mem->boot_rom = NULL;
+    mem->local_state.boot_rom_mapped = 0;
 
+    if (boot_rom_file != NULL) {
+        //Load boot ROM. If load fails, keep it disabled
+        if (load_boot_rom_data(mem, boot_rom_file)) {
+            mem->boot_rom = NULL;
             mem->boot_rom_size = 0;
             mem->local_state.boot_rom_mapped = 0;
         }
@@ -92,10 +140,10 @@ Memory* memory_init(FILE* rom_file, FILE* boot_rom_file) {
     //Start with no buttons pressed
     mem->local_state.button_state = 0x0F;
     mem->local_state.dpad_state = 0x0F;
+    mem->local_state.pending_interrupts = 0;
 
     //If there was an error in initializing any required memory, destroy memory struct and return NULL
-    if (mem->vram_0 == NULL || mem->wram_x == NULL || mem->oam == NULL || mem->io == NULL || mem->hram == NULL ||
-        mem->rom_x == NULL) {
+    if (mem->rom_x == NULL || mem->game_name == NULL) {
         memory_destroy(mem);
         return NULL;
     }
@@ -108,23 +156,46 @@ void memory_destroy(Memory* mem) {
     if (mem == NULL)
         return;
 
-    if (mem->mbc_chip != NULL) { mbc_destroy(mem->mbc_chip); }
-    if (mem->vram_0 != NULL) { free(mem->vram_0); }
-    if (mem->wram_x != NULL) { free(mem->wram_x); }
-    if (mem->oam != NULL) { free(mem->oam); }
-    if (mem->io != NULL) { free(mem->io); }
-    if (mem->hram != NULL) { free(mem->hram); }
-    if (mem->rom_x != NULL) { free(mem->rom_x); }
-    if (mem->exram_x != NULL) { free(mem->exram_x); }
-    if (mem->boot_rom != NULL) { free(mem->boot_rom); }
-
-    free(mem);
+    if (mem->rom_image != NULL) { rom_image_release(mem->rom_image); }
+    if (mem->save_file != NULL) { save_file_close(mem->save_file); }
+
+    //Everything else is in the arena, including the struct itself, so the arena has to come out of it first
+    Arena arena = mem->arena;
+    arena_destroy(&arena);
+}
+
+//Total space memory_init needs in the arena, plus whatever the rest of the machine asked for
+static size_t memory_arena_size(size_t exram_size, size_t boot_rom_size, size_t system_size) {
+    size_t size = 0;
+
+    size += ARENA_SPACE(sizeof(Memory), MEMORY_REGION_ALIGNMENT);
+    size += ARENA_SPACE(MEMORY_HOT_SIZE, MEMORY_REGION_ALIGNMENT);
+    size += ARENA_SPACE(0x2000, MEMORY_REGION_ALIGNMENT); //VRAM
+    size += ARENA_SPACE(0x2000, MEMORY_REGION_ALIGNMENT); //WRAM
+    size += ARENA_SPACE(sizeof(MBC_Data), ARENA_ALIGNMENT);
+    size += ARENA_SPACE(sizeof(MBC), ARENA_ALIGNMENT);
+    size += ARENA_SPACE(GAME_NAME_SIZE, ARENA_ALIGNMENT);
+    size += ARENA_SPACE(exram_size, MEMORY_REGION_ALIGNMENT); //Only used if it isn't mapped from the save file
+    size += ARENA_SPACE(boot_rom_size, ARENA_ALIGNMENT);
+    size += system_size;
+
+    return size;
+}
+
+//Gets file size and leaves the file at the start
+static long get_file_size(FILE* file) {
+    fseek(file, 0, SEEK_END);
+    long num_bytes = ftell(file);
+    rewind(file);
+
+    return (num_bytes > 0) ? num_bytes : 0;
 }
 
 //Gets data for MBC initialization
-MBC_Data* get_mbc_data(FILE* rom_file) {
+//Return 0 for success, 1 for failure
+uint8_t get_mbc_data(FILE* rom_file, MBC_Data* data) {
     if (rom_file == NULL)
-        return NULL;
+        return 1;
 
     //Get MBC chip data
     //Gets intial buffer sizes and MBC type
@@ -133,58 +204,23 @@ MBC_Data* get_mbc_data(FILE* rom_file) {
     uint8_t ram_byte;
 
     //Get MBC, ROM, and RAM bytes and return if it can't be found
-    //MBC Type byte
+    //They're right next to each other in the header (0x147-0x149), so they all get read at once
+    uint8_t header[3];
     fseek(rom_file, 0x147, SEEK_SET);
-    if (fread(&mbc_type, 1, 1, rom_file) == 0) {
-        rewind(rom_file); //Reset file pointer...
-        return NULL;
-    }
-
-    //MBC Rom byte
-    fseek(rom_file, 0x148, SEEK_SET);
-    if (fread(&rom_byte, 1, 1, rom_file) == 0) {
-        rewind(rom_file); //Reset file pointer...
-        return NULL;
-    }
-
-    //MBC Ram byte
-    fseek(rom_file, 0x149, SEEK_SET);
-    if (fread(&ram_byte, 1, 1, rom_file) == 0) {
+    if (fread(header, 1, 3, rom_file) != 3) {
         rewind(rom_file); //Reset file pointer...
-        return NULL;
+        return 1;
     }
 
-    //Get pointer for data
-    MBC_Data* data = (MBC_Data*)malloc(sizeof(MBC_Data));
-    if (data == NULL) {
-        rewind(rom_file); //Reset file pointer...
-        return NULL;
-    }
+    mbc_type = header[0]; //MBC Type byte
+    rom_byte = header[1]; //MBC Rom byte
+    ram_byte = header[2]; //MBC Ram byte
 
     data->mbc_type_byte = mbc_type;
     data->mbc_rom_size_byte = rom_byte;
     data->mbc_ram_size_byte = ram_byte;
 
     rewind(rom_file); //Reset file pointer...
-    return data;
-}
-
-//Load ROM Data
-//Return 0 for success, 1 if failure
-uint8_t load_rom_data(Memory* mem, FILE* rom_file) {
-    if (rom_file == NULL)
-        return 1;
-
-    //Load ROM...
-    fseek(rom_file, 0, SEEK_END);
-    long num_bytes = ftell(rom_file);
-    rewind(rom_file);
-
-    if (!fread(mem->rom_x, 1, num_bytes, rom_file)) {
-        printError("ROM file too small!");
-        return 1;
-    }
-
     return 0;
 }
 
@@ -192,34 +228,49 @@ uint8_t load_rom_data(Memory* mem, FILE* rom_file) {
 //Return 0 for success, 1 for failure
 uint8_t load_save_data(Memory* mem) {
     //Load save file (if it exists)
-    char file_path[100] = "saves/";
-    strcat(file_path, mem->game_name);
-    strcat(file_path, ".sav");
+    char file_path[100];
+    get_save_path(mem, file_path);
     FILE* save_data = fopen(file_path, "rb");
 
-    if (save_data != NULL && mem->mbc_chip->has_battery && mem->exram_x != NULL) {
-        //Get buffer size
-        fseek(save_data, 0, SEEK_END);
-        long size = ftell(save_data);
-        rewind(save_data);
+    if (save_data != NULL && mem->mbc_chip->has_battery) {
+        uint8_t result = 0;
 
-        if (!fread(mem->exram_x, 1, size, save_data)) {
-            fclose(save_data);
-            return 1;
-        }
+        //If EXRAM is mapped from the file it's already there
+        if (mem->save_file == NULL && mem->exram_x != NULL && !fread(mem->exram_x, 1, mem->mbc_chip->exram_size, save_data))
+            result = 1;
+
+        //MBC knows what else goes in its save, which comes after EXRAM
+        fseek(save_data, (long)mem->mbc_chip->exram_size, SEEK_SET);
+        if (result == 0)
+            result = mem->mbc_chip->interface->load(mem->mbc_chip, save_data);
 
         fclose(save_data);
+
+        return result;
     }
-    else
+    else {
+        if (save_data != NULL)
+            fclose(save_data);
+
         return 1;
+    }
 }
 
 //Saves save data
 void save_save_data(Memory* mem) {
+    if (!mem->mbc_chip->has_battery || mem->save_in_use)
+        return;
+
+    //Mapped EXRAM is already in the file, so it and the trailer just have to make it to the disk
+    if (mem->save_file != NULL) {
+        save_update_trailer(mem);
+        save_file_flush(mem->save_file);
+        return;
+    }
+
     //Get file path
-    char file_path[100] = "saves/";
-    strcat(file_path, mem->game_name);
-    strcat(file_path, ".sav");
+    char file_path[100];
+    get_save_path(mem, file_path);
 
     FILE* save = fopen(file_path, "wb");
 
@@ -229,13 +280,39 @@ void save_save_data(Memory* mem) {
         save = fopen(file_path, "wb"); //Try to open file again. If that fails, no save data :(
     }
 
-    if (save != NULL && mem->mbc_chip->has_battery && mem->exram_x != NULL) {
-        fwrite((void*)mem->exram_x, 1, mem->mbc_chip->num_exram_banks * 0x2000, save);
+    if (save != NULL) {
+        if (mem->exram_x != NULL)
+            fwrite((void*)mem->exram_x, 1, mem->mbc_chip->exram_size, save);
+
+        uint8_t trailer[MBC_SAVE_TRAILER_MAX];
+        size_t trailer_size = mem->mbc_chip->interface->save(mem->mbc_chip, trailer);
+
+        fseek(save, (long)mem->mbc_chip->exram_size, SEEK_SET);
+        fwrite(trailer, 1, trailer_size, save);
 
         fclose(save);
     }
 }
 
+//Gives the save file's flusher the latest trailer, so the clock gets saved even if the emulator never closes properly
+void save_update_trailer(Memory* mem) {
+    if (mem->save_file == NULL)
+        return;
+
+    uint8_t trailer[MBC_SAVE_TRAILER_MAX];
+    size_t trailer_size = mem->mbc_chip->interface->save(mem->mbc_chip, trailer);
+
+    if (trailer_size != 0)
+        save_file_set_trailer(mem->save_file, trailer, trailer_size);
+}
+
+//Save file for this game goes in saves/
+void get_save_path(Memory* mem, char* file_path) {
+    strcpy(file_path, "saves/");
+    strcat(file_path, mem->game_name);
+    strcat(file_path, ".sav");
+}
+
 //Load boot ROM
 //Return 0 for success, 1 for failure
 uint8_t load_boot_rom_data(Memory* mem, FILE* boot_rom_file) {
@@ -243,15 +320,13 @@ uint8_t load_boot_rom_data(Memory* mem, FILE* boot_rom_file) {
         return 1;
 
     //Load boot ROM...
-    fseek(boot_rom_file, 0, SEEK_END);
-    long num_bytes = ftell(boot_rom_file);
-    rewind(boot_rom_file);
+    long num_bytes = get_file_size(boot_rom_file);
 
-    //Create buffer for boot ROM
-    mem->boot_rom = (uint8_t*)malloc(num_bytes);
+    //Space for it was set aside in the arena when it was made
+    mem->boot_rom = (uint8_t*)arena_alloc(&mem->arena, (size_t)num_bytes, ARENA_ALIGNMENT);
 
-    if (!fread(mem->boot_rom, 1, num_bytes, boot_rom_file)) {
-        printError("ROM file too small!");
+    if (mem->boot_rom == NULL || !fread(mem->boot_rom, 1, num_bytes, boot_rom_file)) {
+        log_message(LOG_LEVEL_ERROR, "ROM file too small!");
         return 1;
     }
 
@@ -271,8 +346,8 @@ void get_game_name(Memory* mem) {
         return;
 
     //Allocate space. Game name will only be max 16 characters
-    //It is NULL terminated
-    mem->game_name = (char*)calloc(16, 1);
+    //It is NULL terminated, so that's 17 bytes
+    mem->game_name = (char*)arena_alloc(&mem->arena, GAME_NAME_SIZE, ARENA_ALIGNMENT);
 
     int mem_index = 0x134;
     int name_index = 0;
@@ -338,9 +413,6 @@ MemoryValue get_memory_value(Memory* mem, uint16_t address) {
 
 //Get memory pointer for ROM area
 uint8_t* get_rom_ptr(Memory* mem, uint16_t address) {
-    //Get index
-    uint32_t index;
-   
     //If BOOT rom is enabled and reading from it return that
     //TODO: Put boot rom stuff in a better spot
     if (address < mem->boot_rom_size) {
@@ -349,21 +421,11 @@ uint8_t* get_rom_ptr(Memory* mem, uint16_t address) {
         }
     }
 
-    if (address < 0x4000) {
-        index = address; //Always bank 0 on non mbc1 cartridges
-
-        //On MBC1 in mode 1, this bank is a little weirder
-        if (mem->mbc_chip->mbc_type == MBC_1) {
-            //In mode 1, ROM bank is the value of BANK2, which is the upper 3 bits in this case
-            if (mem->mbc_chip->mbc_mode == 1) {
-                index = address + ((mem->mbc_chip->current_rom_bank & ~0x9F) * 0x4000); //Switchable
-            }
-        }
-    }
-    else
-        index = (address - 0x4000) + (mem->mbc_chip->current_rom_bank * 0x4000); //Switchable
+    //MBC keeps pointers to the current banks (bank 0 can switch on MBC1 in mode 1)
+    if (address < 0x4000)
+        return &mem->mbc_chip->rom_bank_0[address];
 
-    return &mem->rom_x[index];
+    return &mem->mbc_chip->rom_bank_x[address - 0x4000]; //Switchable
 }
 
 //Get memory pointer from VRAM area
@@ -376,14 +438,12 @@ uint8_t* get_vram_ptr(Memory* mem, uint16_t address) {
 
 //Get memory pointer from EXRAM area
 uint8_t* get_exram_ptr(Memory* mem, uint16_t address) {
-    //Get index
-    uint32_t index;
-    if (mem->mbc_chip->mbc_type != MBC_2)
-        index = (((address - 0xA000) + (mem->mbc_chip->current_exram_bank * 0x2000))) % (mem->mbc_chip->num_exram_banks * 0x2000);
-    else
-        index = (address - 0xA000) % 0x200; //MBC2 only has 0x200 bytes for some reason
+    //No EXRAM means nothing to point at
+    if (mem->mbc_chip->exram_bank == NULL)
+        return NULL;
 
-    return &mem->exram_x[index];
+    //MBC2 only has 0x200 bytes for some reason, so the mask wraps it around
+    return &mem->mbc_chip->exram_bank[(address - 0xA000) & mem->mbc_chip->exram_mask];
 }
 
 //Get memory pointer from WRAM area
@@ -392,8 +452,7 @@ uint8_t* get_wram_ptr(Memory* mem, uint16_t address) {
     return &mem->wram_x[address - 0xC000];
 }
 
-//Disables boot rom and frees space if bootrom exists
+//Disables boot rom. Its space is in the arena, so it just stays there until memory is destroyed
 void disable_bootrom(Memory* mem) {
-    if (mem->boot_rom != NULL) { free(mem->boot_rom); }
     mem->local_state.boot_rom_mapped = 0;
 }
\ No newline at end of file
@@ -2,44 +2,76 @@
 #include "logging.h"
 #include "hardware_def.h"
 #include "hardware_registers.h"
+#include "block_cache.h"
+#include "interrupt_handler.h"
+#include "dma.h"
+#include "ppu.h"
+#include "apu.h"
 
 #include <stdlib.h>
 
-MemoryBus* memory_bus_init(Memory* mem, GlobalSystemState* system_state) {
-	if (mem == NULL || system_state == NULL) {
-		printError("Error intializing memory bus");
-		return NULL;
-	}
-
-	MemoryBus* bus = (MemoryBus*)malloc(sizeof(MemoryBus));
-
-	if (bus == NULL) {
-		printError("Error intializing memory bus");
+MemoryBus* memory_bus_init(MemoryBus* bus, Memory* mem, GlobalSystemState* system_state) {
+	if (bus == NULL || mem == NULL || system_state == NULL) {
+		log_message(LOG_LEVEL_ERROR, "Error intializing memory bus");
 		return NULL;
 	}
 
 	bus->memory = mem;
 	bus->system_state = system_state;
+	bus->block_cache = NULL;
+	bus->ppu = NULL;
+	bus->apu = NULL;
+	bus->fetch_window = (FetchWindow){ .base = NULL, .start = 0, .length = 0 };
+
+	memory_map_update(bus);
 
 	return bus;
 }
 
-void memory_bus_destroy(MemoryBus* bus) {
-	if (bus != NULL)
-		free(bus);
+//The PPU only runs when something could see it, so anything other than the PPU itself touching video memory
+//or the LCD registers (0xFF40-0xFF4B) has to catch it up first
+static inline uint8_t touches_ppu(MemoryRange range, uint16_t address, Accessor accessor) {
+	if (accessor == PPU_ACCESS)
+		return 0;
+
+	return range == RANGE_VRAM || range == RANGE_OAM || (address >= 0xFF40 && address <= 0xFF4B);
+}
+
+//Same for the APU with the sound registers and wave RAM (0xFF10-0xFF3F). Only the CPU ever touches those
+static inline uint8_t touches_apu(uint16_t address) {
+	return address >= 0xFF10 && address <= 0xFF3F;
 }
 
 //Reads memory or returns 0xFF as a default value if location is inaccessible
 uint8_t mem_read(MemoryBus* bus, uint16_t address, Accessor accessor) {
+	//Most reads land in a page that can just be read directly
+	uint8_t* page = bus->read_pages[address >> 8];
+	if (page != NULL)
+		return page[address & 0xFF];
+
 	//Get memory information from memory module
 	MemoryValue mem_value = get_memory_value(bus->memory, address); //Gets memory information
+
+	//Access to VRAM and OAM depends on the PPU mode, so this has to happen before checking it
+	if (bus->ppu != NULL && touches_ppu(mem_value.range, address, accessor))
+		ppu_catch_up(bus->ppu, bus->system_state->timer_state->elapsed_time);
+	if (bus->apu != NULL && touches_apu(address))
+		apu_catch_up(bus->apu, bus->system_state->timer_state->elapsed_time);
 	
 	//If memory area is inaccessible, then reutrn 0xFF as a default
 	if (!mem_accessible(bus, mem_value.range, accessor) || mem_value.mem_ptr == NULL) {
-		printError("Read at inaccessible address");
+		LOG_HOT(LOG_LEVEL_WARNING, "Read at inaccessible address");
 		return 0xFF;
 	}
 
+	//OAM only gets the DMA bytes copied in when something actually looks at it
+	//The PPU can be behind, so its reads only see what was done by the tick it's on
+	if (mem_value.range == RANGE_OAM && bus->system_state->dma_state->active) {
+		uint64_t time = (accessor == PPU_ACCESS) ? bus->system_state->ppu_state->synced_time :
+			bus->system_state->timer_state->elapsed_time;
+		dma_sync(bus, time);
+	}
+
 	uint8_t result = *(mem_value.mem_ptr);
 
 	//Edge case where MBC2 only returns the lower nibble for EXRAM reads.
@@ -48,9 +80,9 @@ uint8_t mem_read(MemoryBus* bus, uint16_t address, Accessor accessor) {
 
 	//Hardware registers have some special properties
 	if (mem_value.range == RANGE_IO) {
-		//Address 0xFF00 returns current input value. This changes depending on selector bit.
-		//For now, this will just poll SDL events and get the byte based on that
-		if (address == 0xFF00) { result = get_input_byte(bus->memory, result); }
+		//Registers with read side effects (just the joypad for now) have a handler in the table
+		HwReadHandler read = hw_registers[(uint8_t)address].read;
+		if (read != NULL) { result = read(bus, address, result); }
 
 		//Most hardware registers are a combination of read/write only, so this masks the output
 		result = mask_hw_reg_read(result, address);
@@ -59,13 +91,86 @@ uint8_t mem_read(MemoryBus* bus, uint16_t address, Accessor accessor) {
 	return result;
 }
 
+//Fetch outside the current window. Does a normal read, then points the window at the page if it's in the read table
+uint8_t mem_fetch_slow(MemoryBus* bus, uint16_t address) {
+	uint8_t result = mem_read(bus, address, CPU_ACCESS);
+	uint8_t* page = bus->read_pages[address >> 8];
+
+	if (page != NULL)
+		bus->fetch_window = (FetchWindow){ .base = page, .start = address & ~(MEMORY_PAGE_SIZE - 1), .length = MEMORY_PAGE_SIZE };
+	else
+		mem_fetch_invalidate(bus);
+
+	return result;
+}
+
+//Rebuilds both page tables. See memory_bus.h for which pages get a pointer
+void memory_map_update(MemoryBus* bus) {
+	Memory* mem = bus->memory;
+	MBC* mbc = mem->mbc_chip;
+
+	mem_fetch_invalidate(bus); //Window might be pointing at a page that just changed
+	memory_access_update(bus); //Same things that change the mapping change what's accessible
+
+	for (int i = 0; i < MEMORY_PAGE_COUNT; ++i) {
+		bus->read_pages[i] = NULL;
+		bus->write_pages[i] = NULL;
+	}
+
+	//During DMA the CPU can only get to HRAM, which isn't in the tables anyway
+	if (bus->system_state->dma_state->active)
+		return;
+
+	//ROM. A boot ROM that ends partway through a page would mean the page isn't one block of memory
+	for (uint16_t address = 0x0000; address < 0x8000; address += MEMORY_PAGE_SIZE) {
+		if (mem->local_state.boot_rom_mapped && mem->boot_rom != NULL && address < mem->boot_rom_size &&
+			address + MEMORY_PAGE_SIZE > mem->boot_rom_size)
+			continue;
+
+		bus->read_pages[address >> 8] = get_rom_ptr(mem, address);
+	}
+
+	//EXRAM, as long as it exists, is enabled and the bank is plain memory filling the whole window
+	if (mbc->exram_bank != NULL && mbc->exram_enabled && mbc->exram_mask == EXRAM_WINDOW_MASK) {
+		for (uint16_t address = 0xA000; address < 0xC000; address += MEMORY_PAGE_SIZE) {
+			bus->read_pages[address >> 8] = get_exram_ptr(mem, address);
+			bus->write_pages[address >> 8] = get_exram_ptr(mem, address);
+		}
+	}
+
+	//WRAM and echo RAM (up to the page OAM is in)
+	for (uint16_t address = 0xC000; address < 0xFE00; address += MEMORY_PAGE_SIZE) {
+		uint8_t* ptr = get_wram_ptr(mem, (address < 0xE000) ? address : address - 0x2000);
+
+		bus->read_pages[address >> 8] = ptr;
+		bus->write_pages[address >> 8] = ptr;
+	}
+}
+
 //Writes to memory and updates emulator state if necessary
 //Returns 0 if no write occurs, 1 if a write does occur
 uint8_t mem_write(MemoryBus* bus, uint16_t address, uint8_t new_val, Accessor accessor) {
+	//Writes to RAM pages in the table don't need anything else, other than letting the block cache know
+	uint8_t* page = bus->write_pages[address >> 8];
+	if (page != NULL) {
+		page[address & 0xFF] = new_val;
+
+		if (bus->block_cache != NULL && address >= 0xC000)
+			block_cache_ram_write(bus->block_cache, address);
+
+		return 0;
+	}
+
 	//Get memory information from memory module
 	MemoryValue mem_value = get_memory_value(bus->memory, address); //Gets memory information
 	uint8_t success = 1; //Defaults to no write
 
+	//Everything before the write has to happen with the old value
+	if (bus->ppu != NULL && touches_ppu(mem_value.range, address, accessor))
+		ppu_catch_up(bus->ppu, bus->system_state->timer_state->elapsed_time);
+	if (bus->apu != NULL && touches_apu(address))
+		apu_catch_up(bus->apu, bus->system_state->timer_state->elapsed_time);
+
 	//If area is accessible and not read only, then do the write stuff
 	if (mem_accessible(bus, mem_value.range, accessor) && mem_value.range != RANGE_ROM && mem_value.mem_ptr != NULL) {
 		uint8_t* mem_ptr = mem_value.mem_ptr;
@@ -77,106 +182,51 @@ uint8_t mem_write(MemoryBus* bus, uint16_t address, uint8_t new_val, Accessor ac
 		//Handle IO Range shenanigans
 		if (mem_value.range == RANGE_IO) {
 			new_val = mask_hw_reg_write(new_val, *mem_ptr, address);
-			update_global_state(bus, address, new_val); //Updates various hardware register related states
-			
-			//If APU is disabled, then APU hardware registers become read only
-			if (address >= 0xFF10 && address <= 0xFF25 && bus->system_state->apu_state->apu_enable == 0)
-				new_val = *mem_ptr; //Set new val to old val, so no writes are done
+
+			//Updates various hardware register related states. The handler decides what actually gets stored
+			HwWriteHandler write = hw_registers[(uint8_t)address].write;
+			if (write != NULL) { new_val = write(bus, address, new_val, *mem_ptr); }
 		}
 
 		//Update memory address with new value
 		//I miiight be missing edge cases?
 		*mem_ptr = new_val;
 		success = 0;
-	}
-
-	//Updates memory bank info. This happens regardless if a write happens or not
-	//(although these registers are typically in ROM so it won't do the write anyway but still)
-	update_current_bank(bus->memory->mbc_chip, address, new_val);
-	return success;
-}
-
-//Updates subsystem state depending on hardware register writes
-void update_global_state(MemoryBus* bus, uint16_t address, uint8_t new_val) {
-	//Writes here disable boot rom
-	if (address == 0xFF50 && bus->memory->local_state.boot_rom_mapped == 1)
-		disable_bootrom(bus->memory);
-
-	//This register begins DMA transfer if its not active already
-	else if (address == 0xFF46) {
-		if (!bus->system_state->dma_state->active) {
-			bus->system_state->dma_state->active = 1;
-			bus->system_state->dma_state->source = new_val;
-		}
-	}
 
-	//Writes to DIV reset system clock
-	else if (address == 0xFF04)
-		bus->system_state->timer_state->system_time = 0;
-
-	//Bit 7 of LCDC controls whether PPU is on or not
-	else if (address == 0xFF40) {
-		if (((new_val >> 7) & 0x1) == 1) {
-			//If LCD was previously off, reset frame time and turn it on
-			if (bus->system_state->ppu_state->lcd_on == 0) {
-				bus->system_state->ppu_state->lcd_on = 1;
-				bus->system_state->ppu_state->frame_time = 4;
-			}
-		}
-		else
-			bus->system_state->ppu_state->lcd_on = 0;
-	}
+		//IF and IE decide which interrupts are pending (IF's handler takes care of itself)
+		if (address == 0xFFFF)
+			updatePendingInterrupts(bus->memory);
 
-	//Bit 7 of NR52 turns on/off APU
-	else if (address == 0xFF26) {
-		if (((new_val >> 7) & 0x1) == 1)
-			bus->system_state->apu_state->apu_enable = 1; //Turn APU on
-		else
-			//Set the flag for APU to clear registers
-			bus->system_state->apu_state->turn_off_apu = 1;
-	}
-
-	//Bit 7 of NRx4 triggers channel x
-	//Bit 6 for channels 1-3 determine if the note has length timer
-	else if (address == 0xFF14) {
-		if (new_val & 0x80)
-			bus->system_state->apu_state->trigger_ch1 = 1;
+		//LCDC, STAT and LYC can make the PPU request an interrupt on the very next tick. Its event works out
+		//when the one after that is
+		if (bus->ppu != NULL && (address == 0xFF40 || address == 0xFF41 || address == 0xFF45))
+			scheduler_post(bus->system_state->scheduler, EVENT_PPU, bus->system_state->ppu_state->synced_time);
 
-		if (new_val & 0x40)
-			bus->system_state->apu_state->ch1_length_enable = 1;
-		else
-			bus->system_state->apu_state->ch1_length_enable = 0;
+		//Writing over cached code means the block cache has to throw it away
+		if (bus->block_cache != NULL && (mem_value.range == RANGE_WRAM || mem_value.range == RANGE_HRAM))
+			block_cache_ram_write(bus->block_cache, address);
 	}
 
-	else if (address == 0xFF19) {
-		if (new_val & 0x80)
-			bus->system_state->apu_state->trigger_ch2 = 1;
+	//Updates memory bank info. This happens regardless if a write happens or not, but only the ROM area
+	//and the EXRAM window are wired to the MBC
+	if (address < 0x8000 || (address >= 0xA000 && address < 0xC000)) {
+		//A transfer that's going might be copying from the bank that's about to go away
+		if (bus->system_state->dma_state->active)
+			dma_mapping_changing(bus);
 
-		if (new_val & 0x40)
-			bus->system_state->apu_state->ch2_length_enable = 1;
-		else
-			bus->system_state->apu_state->ch2_length_enable = 0;
+		mbc_write(bus->memory->mbc_chip, address, new_val);
 	}
 
-	else if (address == 0xFF1E) {
-		if (new_val & 0x80)
-			bus->system_state->apu_state->trigger_ch3 = 1;
+	//Bank switches change what code is mapped, so any block that's running has to stop
+	//and the page tables might be pointing at the old banks
+	if (address < 0x8000) {
+		memory_map_update(bus);
 
-		if (new_val & 0x40)
-			bus->system_state->apu_state->ch3_length_enable = 1;
-		else
-			bus->system_state->apu_state->ch3_length_enable = 0;
+		if (bus->block_cache != NULL)
+			block_cache_mapping_changed(bus->block_cache);
 	}
 
-	else if (address == 0xFF23) {
-		if (new_val & 0x80)
-			bus->system_state->apu_state->trigger_ch4 = 1;
-
-		if (new_val & 0x40)
-			bus->system_state->apu_state->ch4_length_enable = 1;
-		else
-			bus->system_state->apu_state->ch4_length_enable = 0;
-	}
+	return success;
 }
 
 //Handles input register
@@ -224,62 +274,38 @@ uint8_t mask_hw_reg_write(uint8_t new_val, uint8_t old_val, uint16_t address) {
 	return new_val;
 }
 
-//Checks whether memory location is accessible based on memory range and who is accessing
-//Returns 0 for inaccesible, 1 for accessible
-uint8_t mem_accessible(MemoryBus* bus, MemoryRange range, Accessor accessor) {
+//Works out which memory ranges each accessor can get to with the current PPU mode, DMA and EXRAM state
+//Has to be called whenever one of those changes, since mem_accessible just checks the masks
+void memory_access_update(MemoryBus* bus) {
 	uint8_t dma_active = bus->system_state->dma_state->active;
 	PPU_Mode current_ppu_mode = bus->system_state->ppu_state->current_mode;
-	uint8_t accessible = 1; //Default accessible
-
-	switch (range) {
-		//ROM is inaccessible by the CPU when DMA is active
-		case RANGE_ROM:
-			if (dma_active && accessor == CPU_ACCESS)
-				accessible = 0;
-			break;
-
-		//VRAM is inaccessible by CPU during PPU Mode 3 and DMA transfer
-		case RANGE_VRAM:
-			if (accessor == CPU_ACCESS) {
-				if (current_ppu_mode == PPU_MODE_3 || dma_active)
-					accessible = 0;
-			}
-			break;
-
-		//EXRAM is inaccessibly by CPU during DMA or if MBC has it disabled
-		case RANGE_EXRAM:
-			if (bus->memory->exram_x == NULL)
-				accessible = 0;
-
-			if (accessor == CPU_ACCESS) {
-				if (!(bus->memory->mbc_chip->exram_enabled) || dma_active)
-					accessible = 0;
-			}
-			break;
-
-		//WRAM is inaccessible by CPU is DMA transfer is active
-		case RANGE_WRAM:
-			if (accessor == CPU_ACCESS && dma_active)
-				accessible = 0;
-			break;
-
-		//OAM is inaccessible by CPU during DMA transfer and PPU modes 2 and 3
-		case RANGE_OAM:
-			if (accessor == CPU_ACCESS) {
-				if (current_ppu_mode == PPU_MODE_2 || current_ppu_mode == PPU_MODE_3 || dma_active)
-					accessible = 0;
-			}
-			break;
-
-		//Self explanatory
-		case RANGE_PROHIBITED:
-			accessible = 0;
-			break;
-
-		//All other regions always accessible 
-		default:
-			break;
+
+	//Everything except the prohibited range is accessible by default
+	uint8_t all = (uint8_t)~(1 << RANGE_PROHIBITED);
+	uint8_t cpu_mask = all;
+	uint8_t other_mask = all;
+
+	//EXRAM is inaccessible to everything if there isn't any (or an RTC register) mapped
+	if (bus->memory->mbc_chip->exram_bank == NULL) {
+		cpu_mask &= ~(1 << RANGE_EXRAM);
+		other_mask &= ~(1 << RANGE_EXRAM);
 	}
 
-	return accessible;
+	//EXRAM is inaccessible by CPU if MBC has it disabled
+	if (!(bus->memory->mbc_chip->exram_enabled))
+		cpu_mask &= ~(1 << RANGE_EXRAM);
+
+	//VRAM is inaccessible by CPU during PPU Mode 3, OAM during modes 2 and 3
+	if (current_ppu_mode == PPU_MODE_3)
+		cpu_mask &= ~((1 << RANGE_VRAM) | (1 << RANGE_OAM));
+	else if (current_ppu_mode == PPU_MODE_2)
+		cpu_mask &= ~(1 << RANGE_OAM);
+
+	//During DMA transfer the CPU can only get to IO and HRAM
+	if (dma_active)
+		cpu_mask &= (1 << RANGE_IO) | (1 << RANGE_HRAM);
+
+	bus->access_masks[CPU_ACCESS] = cpu_mask;
+	bus->access_masks[PPU_ACCESS] = other_mask;
+	bus->access_masks[DMA_ACCESS] = other_mask;
 }
\ No newline at end of file
@@ -2,21 +2,14 @@
 #include "hardware_def.h"
 #include "logging.h"
 #include "interrupt_handler.h"
-#include <stdlib.h>
+#include <string.h>
 
 //Inline functions
 #define GET_BIT(num, bit) ((num) >> (bit)) & 0x1 //Gets value of specific bit (starting at 0)
 
-PPU* ppu_init(MemoryBus* bus, GlobalPPUState* global_state, SDL_Display_Data* sdl_data) {
-    if (bus == NULL || global_state == NULL || sdl_data == NULL) {
-        printError("Unable to initialize PPU.");
-        return NULL;
-    }
-
-    PPU* ppu = (PPU*)malloc(sizeof(PPU));
-
-    if (ppu == NULL) {
-        printError("Unable to initialize PPU.");
+PPU* ppu_init(PPU* ppu, MemoryBus* bus, GlobalPPUState* global_state, SDL_Display_Data* sdl_data) {
+    if (ppu == NULL || bus == NULL || global_state == NULL || sdl_data == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Unable to initialize PPU.");
         return NULL;
     }
 
@@ -30,33 +23,24 @@ PPU* ppu_init(MemoryBus* bus, GlobalPPUState* global_state, SDL_Display_Data* sd
     ppu->local_state.current_obj_index = 0;
     ppu->local_state.pixel_obj_index = 0;
 
-    ppu->framebuffer = (uint32_t*)calloc((160 * 144), sizeof(uint32_t)); //Gameboy is 160x144
+    memset(ppu->framebuffer, 0, sizeof(ppu->framebuffer));
 
     //Palette grey-scale colors...
-    ppu->palette = (PaletteData*)calloc(1, sizeof(PaletteData));
-    
-    if (ppu->framebuffer == NULL || ppu->palette == NULL) {
-        printError("Error initializing PPU");
-        ppu_destroy(ppu);
-        return NULL;
-    }
-
     //For now, emulator only has 1 palette
     uint32_t colors[4] = { PALETTE_WHITE, PALETTE_LIGHT_GRAY, PALETTE_DARK_GRAY, PALETTE_BLACK };
 
-    memcpy(ppu->palette->BG_Palette, colors, 4 * sizeof(uint32_t));
-    memcpy(ppu->palette->OBJ0_Palette, colors, 4 * sizeof(uint32_t));
-    memcpy(ppu->palette->OBJ1_Palette, colors, 4 * sizeof(uint32_t));
+    memcpy(ppu->palette.BG_Palette, colors, 4 * sizeof(uint32_t));
+    memcpy(ppu->palette.OBJ0_Palette, colors, 4 * sizeof(uint32_t));
+    memcpy(ppu->palette.OBJ1_Palette, colors, 4 * sizeof(uint32_t));
 
-    return ppu;
-}
+    //Frame time starts at 0, which counts as the end of a frame, so SDL gets polled on the very first tick
+    scheduler_post(bus->system_state->scheduler, EVENT_FRAME_END, 0);
 
-void ppu_destroy(PPU* ppu) {
-    if (ppu == NULL)
-        return;
+    //Bus catches the PPU up whenever video memory or LCD registers get accessed
+    bus->ppu = ppu;
+    ppu_post_interrupt(ppu);
 
-    if (ppu->framebuffer != NULL) { free(ppu->framebuffer); }
-    if (ppu->palette != NULL) { free(ppu->palette); }
+    return ppu;
 }
 
 //Updates PPU based on current frame time
@@ -79,6 +63,91 @@ void update_ppu(PPU* ppu) {
     }
 }
 
+//Does every tick the PPU hasn't done yet before time
+void ppu_catch_up(PPU* ppu, uint64_t time) {
+    GlobalPPUState* state = ppu->global_state;
+    uint8_t settled = 0; //Previous tick wasn't on a boundary, so the next one won't change anything if it isn't either
+
+    while (state->synced_time < time) {
+        uint32_t scanline_time = state->frame_time % SCANLINE_END;
+        uint8_t boundary = scanline_time == MODE_0_END || scanline_time == MODE_2_END || scanline_time == MODE_3_END;
+
+        //LY, STAT and the mode can only change on a boundary (or the tick after, when the STAT line can drop again).
+        //Outside of mode 3 the only other thing is OAM scan, which only reads an object every other tick until it
+        //has 10, so anything else goes straight to the next tick that does something
+        uint8_t scanning = state->current_mode == PPU_MODE_2 && ppu->local_state.current_obj_index < 10;
+        if (settled && !boundary && state->current_mode != PPU_MODE_3 && !(scanning && scanline_time % 2 == 0)) {
+            uint32_t skip;
+            if (scanning)
+                skip = 1;
+            else if (scanline_time < MODE_2_END)
+                skip = MODE_2_END - scanline_time;
+            else if (scanline_time < MODE_3_END)
+                skip = MODE_3_END - scanline_time;
+            else
+                skip = SCANLINE_END - scanline_time;
+
+            if (skip > time - state->synced_time)
+                skip = (uint32_t)(time - state->synced_time);
+
+            state->frame_time += skip;
+            state->synced_time += skip;
+            continue;
+        }
+
+        update_ppu(ppu);
+        ++state->frame_time;
+        ++state->synced_time;
+        settled = !boundary;
+    }
+}
+
+//Handles the PPU event by doing the tick that could request an interrupt, then posts the next one
+void ppu_event(PPU* ppu, uint64_t time) {
+    ppu_catch_up(ppu, time + 1);
+    ppu_post_interrupt(ppu);
+}
+
+//Ticks from frame time until scanline time next hits scanline_time (0 if it's right now)
+static uint32_t ticks_until_scanline_time(uint32_t frame_time, uint32_t scanline_time) {
+    return (scanline_time + SCANLINE_END - frame_time % SCANLINE_END) % SCANLINE_END;
+}
+
+//Posts the next tick the PPU could request an interrupt on, so it gets caught up in time to request it.
+//Frame end is a multiple of SCANLINE_END, so frame time going back to 0 doesn't change scanline times
+void ppu_post_interrupt(PPU* ppu) {
+    GlobalPPUState* state = ppu->global_state;
+    Scheduler* scheduler = ppu->bus->system_state->scheduler;
+    uint32_t frame_time = state->frame_time;
+    uint8_t stat = ppu->bus->memory->STAT_LOCATION;
+    uint32_t ticks = UINT32_MAX;
+
+    //VBlank interrupt (and the mode 1 STAT interrupt). With the LCD off, frame time doesn't go back to 0
+    if (state->lcd_on || GET_BIT(stat, 4)) {
+        if (frame_time <= VBLANK_BEGIN)
+            ticks = VBLANK_BEGIN - frame_time;
+        else if (state->lcd_on)
+            ticks = MODE_1_END - frame_time + VBLANK_BEGIN;
+    }
+
+    //Mode 0 STAT interrupt
+    if (GET_BIT(stat, 3) && ticks_until_scanline_time(frame_time, MODE_3_END) < ticks)
+        ticks = ticks_until_scanline_time(frame_time, MODE_3_END);
+
+    //Mode 2 STAT interrupt, and LY changing for the LYC one. LY also changes on the tick after frame end
+    if (GET_BIT(stat, 5) || (GET_BIT(stat, 6) && state->lcd_on)) {
+        if (ticks_until_scanline_time(frame_time, MODE_0_END) < ticks)
+            ticks = ticks_until_scanline_time(frame_time, MODE_0_END);
+        if (GET_BIT(stat, 6) && frame_time <= 1 && 1 - frame_time < ticks)
+            ticks = 1 - frame_time;
+    }
+
+    if (ticks == UINT32_MAX)
+        scheduler_cancel(scheduler, EVENT_PPU);
+    else
+        scheduler_post(scheduler, EVENT_PPU, state->synced_time + ticks);
+}
+
 //Does OAM scan
 void ppu_oam_scan(PPU* ppu) {
     //OAM scan takes 80 ticks, but only reads 40 objects
@@ -115,7 +184,7 @@ void ppu_write_lcd(PPU* ppu) {
 
     //Get framebuffer index and ouput to frame buffer
     uint32_t framebuffer_i = 160 * ppu->bus->memory->LY_LOCATION + mode_3_time;
-    ppu->framebuffer[framebuffer_i] = ppu->palette->BG_Palette[color_id];
+    ppu->framebuffer[framebuffer_i] = ppu->palette.BG_Palette[color_id];
 }
 
 void update_stat(PPU* ppu) {
@@ -164,32 +233,90 @@ void switch_mode_0_1(PPU* ppu) {
     requestInterrupt(INTERRUPT_VBLANK, ppu->bus->memory);
 
     ppu->local_state.window_ly = 0; //Reset internal window counter
-    ppu->global_state->current_mode = PPU_MODE_1; //Update PPU mode
+    set_ppu_mode(ppu, PPU_MODE_1); //Update PPU mode
 }
 
 //Switch from mode 1 to mode 2 (vblank to oam scan)
 void switch_mode_1_2(PPU* ppu) {
     //At end of VBLANK
-    ppu->global_state->current_mode = PPU_MODE_2; //Update current PPU mode
+    set_ppu_mode(ppu, PPU_MODE_2); //Update current PPU mode
     ppu->global_state->frame_time = 0; //Reset frame time back to 0
 
-    //Draws buffer through SDL and waits to maintain framerate
-    draw_buffer(ppu->sdl_data, ppu->framebuffer, ppu->global_state->frame_rate);
+    //Finished frame gets drawn by the frame end event, which runs right before this on the same tick
 }
 
 //Switch from mode 2 to mode 3 (oam scan to draw scanline)
 void switch_mode_2_3(PPU* ppu) {
     ppu->local_state.window_ly_increment = 1; //Allow window LY to get incremented again for this scanline
-    ppu->global_state->current_mode = PPU_MODE_3; //Update PPU mode to mode 3
+    set_ppu_mode(ppu, PPU_MODE_3); //Update PPU mode to mode 3
 }
 
 //Switch from mode 3 to mode 0 (draw scanline to hblank)
 void switch_mode_3_0(PPU* ppu) {
     ppu->local_state.current_obj_index = 0; //Reset scanline sprite index
-    ppu->global_state->current_mode = PPU_MODE_0;
+    set_ppu_mode(ppu, PPU_MODE_0);
 }
 
 //Switch from mode 0 to mode 2 (hblank to oam scan)
 void switch_mode_0_2(PPU* ppu) {
-    ppu->global_state->current_mode = PPU_MODE_2;
-}
\ No newline at end of file
+    set_ppu_mode(ppu, PPU_MODE_2);
+}
+
+//Changes the PPU mode. The CPU's access to VRAM and OAM depends on it, so the bus has to know too
+void set_ppu_mode(PPU* ppu, PPU_Mode mode) {
+    if (ppu->global_state->current_mode == mode)
+        return;
+
+    ppu->global_state->current_mode = mode;
+    memory_access_update(ppu->bus);
+}
+
+//Everything the CPU can see from the PPU (LY, STAT mode/LYC bits, VBlank/STAT interrupts) only changes
+//on ticks where frame time lands on a mode boundary, so this is the number of ticks until the next one.
+//Frame end (MODE_1_END) is a multiple of SCANLINE_END, so that counts as a boundary too
+uint32_t ppu_ticks_until_change(PPU* ppu) {
+    ppu_catch_up(ppu, ppu->bus->system_state->timer_state->elapsed_time);
+
+    //Nothing changes with the LCD off until something writes LCDC
+    if (!ppu->global_state->lcd_on)
+        return UINT32_MAX;
+
+    uint32_t scanline_time = ppu->global_state->frame_time % SCANLINE_END;
+
+    if (scanline_time == MODE_0_END || scanline_time == MODE_2_END || scanline_time == MODE_3_END)
+        return 0;
+    if (scanline_time < MODE_2_END)
+        return MODE_2_END - scanline_time;
+    if (scanline_time < MODE_3_END)
+        return MODE_3_END - scanline_time;
+
+    return SCANLINE_END - scanline_time;
+}
+
+//LY only changes at the start of a scanline
+uint32_t ppu_ticks_until_ly_change(PPU* ppu) {
+    ppu_catch_up(ppu, ppu->bus->system_state->timer_state->elapsed_time);
+
+    if (!ppu->global_state->lcd_on)
+        return UINT32_MAX;
+
+    uint32_t scanline_time = ppu->global_state->frame_time % SCANLINE_END;
+
+    if (scanline_time == 0)
+        return 0;
+
+    return SCANLINE_END - scanline_time;
+}
+
+//Frame ends (and SDL gets polled) on the tick where frame time hits MODE_1_END and goes back to 0.
+//Posts that as the next frame end event, or takes it off if the LCD is off, since then frame time doesn't go back to 0.
+//Has to be redone whenever the LCD gets turned on or off, and after every frame end
+void ppu_post_frame_end(Scheduler* scheduler, GlobalPPUState* ppu_state, uint64_t now) {
+    if (!ppu_state->lcd_on) {
+        scheduler_cancel(scheduler, EVENT_FRAME_END);
+        return;
+    }
+
+    //On the frame end tick itself, frame time is still MODE_1_END, so the next one is a whole frame away
+    scheduler_post(scheduler, EVENT_FRAME_END, now + MODE_1_END - ppu_state->frame_time % MODE_1_END);
+}
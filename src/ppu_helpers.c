@@ -18,7 +18,7 @@ void update_ppu_state(PPU* ppu) {
 
     //If PPU is off, mode is Off, keep LY at 0
     else {
-        ppu->global_state->current_mode = PPU_MODE_OFF;
+        set_ppu_mode(ppu, PPU_MODE_OFF);
         ppu->bus->memory->LY_LOCATION = 0;
 
         return; //No updates are done if PPU is off
@@ -0,0 +1,38 @@
+#include "recomp.h"
+#include "rom_image.h"
+
+//Empty registry for when there's no recompiled ROM linked in
+#ifndef RECOMPILED_ROM
+const RecompBlock recomp_blocks[] = { {0, 0, NULL} };
+const uint32_t recomp_num_blocks = 0;
+const uint64_t recomp_rom_checksum = 0;
+#endif
+
+uint8_t recomp_matches_rom(Memory* mem) {
+    if (recomp_num_blocks == 0 || mem->rom_image == NULL)
+        return 0;
+
+    //Same hash the ROM image uses, so the ROM only ever gets hashed once
+    return rom_image_hash(mem->rom_image) == recomp_rom_checksum;
+}
+
+//Binary search, since the tool sorts the registry
+RecompBlockFn recomp_lookup(uint16_t bank, uint16_t pc) {
+    uint32_t low = 0;
+    uint32_t high = recomp_num_blocks;
+    uint32_t key = ((uint32_t)bank << 16) | pc;
+
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        uint32_t mid_key = ((uint32_t)recomp_blocks[mid].bank << 16) | recomp_blocks[mid].pc;
+
+        if (mid_key == key)
+            return recomp_blocks[mid].function;
+        else if (mid_key < key)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return NULL;
+}
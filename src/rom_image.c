@@ -0,0 +1,258 @@
+#include "rom_image.h"
+#include "logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//mmap is only around on POSIX systems, everything else reads the ROM into a buffer
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <pthread.h>
+    #define ROM_IMAGE_MMAP
+#endif
+
+//Every image that's loaded right now
+static RomImage* registry = NULL;
+
+#ifdef ROM_IMAGE_MMAP
+    static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+    #define LOCK_REGISTRY() pthread_mutex_lock(&registry_lock)
+    #define UNLOCK_REGISTRY() pthread_mutex_unlock(&registry_lock)
+#else
+    #define LOCK_REGISTRY()
+    #define UNLOCK_REGISTRY()
+#endif
+
+//Helper functions
+static uint8_t load_image(RomImage* image, FILE* rom_file);
+static uint8_t load_image_buffer(RomImage* image, FILE* rom_file);
+static void unload_image(RomImage* image);
+static void get_file_id(RomImage* image, FILE* rom_file);
+static uint8_t same_rom(RomImage* a, RomImage* b);
+static uint64_t hash_image(RomImage* image);
+
+//Gets the image for a ROM, loading it if no one else has already
+//rom_size is the size from the cartridge header
+RomImage* rom_image_acquire(FILE* rom_file, size_t rom_size) {
+    if (rom_file == NULL || rom_size == 0) {
+        log_message(LOG_LEVEL_ERROR, "Error loading ROM");
+        return NULL;
+    }
+
+    RomImage* image = (RomImage*)calloc(1, sizeof(RomImage));
+    if (image == NULL) {
+        log_message(LOG_LEVEL_ERROR, "Error loading ROM");
+        return NULL;
+    }
+
+    image->size = rom_size;
+    get_file_id(image, rom_file);
+
+    LOCK_REGISTRY();
+
+    //Same file is already loaded, so there's nothing to read at all
+    if (image->has_file_id) {
+        for (RomImage* other = registry; other != NULL; other = other->next) {
+            if (same_rom(other, image)) {
+                ++other->references;
+                UNLOCK_REGISTRY();
+
+                free(image);
+                return other;
+            }
+        }
+    }
+
+    UNLOCK_REGISTRY();
+
+    if (load_image(image, rom_file)) {
+        free(image);
+        log_message(LOG_LEVEL_ERROR, "Error loading ROM");
+        return NULL;
+    }
+
+    LOCK_REGISTRY();
+
+    //Someone else might've loaded the same file in the meantime (or, without a file identity, the same ROM)
+    for (RomImage* other = registry; other != NULL; other = other->next) {
+        if (same_rom(other, image)) {
+            ++other->references;
+            UNLOCK_REGISTRY();
+
+            unload_image(image);
+            free(image);
+            return other;
+        }
+    }
+
+    image->references = 1;
+    image->next = registry;
+    registry = image;
+
+    UNLOCK_REGISTRY();
+
+    return image;
+}
+
+//Lets go of an image. Unloads it if nothing else is using it
+void rom_image_release(RomImage* image) {
+    if (image == NULL)
+        return;
+
+    LOCK_REGISTRY();
+
+    if (--image->references > 0) {
+        UNLOCK_REGISTRY();
+        return;
+    }
+
+    //Take it out of the registry
+    for (RomImage** link = &registry; *link != NULL; link = &(*link)->next) {
+        if (*link == image) {
+            *link = image->next;
+            break;
+        }
+    }
+
+    UNLOCK_REGISTRY();
+
+    unload_image(image);
+    free(image);
+}
+
+//Maps the ROM file, or reads it if it can't be mapped
+//Returns 0 for success, 1 for failure
+static uint8_t load_image(RomImage* image, FILE* rom_file) {
+#ifdef ROM_IMAGE_MMAP
+    int fd = fileno(rom_file);
+    struct stat file_info;
+
+    if (fstat(fd, &file_info) != 0 || file_info.st_size <= 0)
+        return load_image_buffer(image, rom_file);
+
+    size_t file_size = (size_t)file_info.st_size;
+
+    //Normal case, the whole ROM is in the file
+    if (file_size >= image->size) {
+        void* data = mmap(NULL, image->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+            return load_image_buffer(image, rom_file);
+
+        image->data = (const uint8_t*)data;
+        image->map_size = image->size;
+        image->type = ROM_IMAGE_MAPPED;
+        return 0;
+    }
+
+    //File is smaller than the header says, so reserve the whole thing as zeroes
+    //and then map the file over the start of it
+    void* data = mmap(NULL, image->size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return load_image_buffer(image, rom_file);
+
+    if (mmap(data, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(data, image->size);
+        return load_image_buffer(image, rom_file);
+    }
+
+    image->data = (const uint8_t*)data;
+    image->map_size = image->size;
+    image->type = ROM_IMAGE_PADDED;
+    return 0;
+#else
+    return load_image_buffer(image, rom_file);
+#endif
+}
+
+//Reads the ROM into a buffer, anything past the end of the file is 0
+static uint8_t load_image_buffer(RomImage* image, FILE* rom_file) {
+    uint8_t* data = (uint8_t*)calloc(image->size, 1);
+    if (data == NULL)
+        return 1;
+
+    rewind(rom_file);
+    if (fread(data, 1, image->size, rom_file) == 0) {
+        free(data);
+        return 1;
+    }
+
+    image->data = data;
+    image->map_size = image->size;
+    image->type = ROM_IMAGE_BUFFER;
+    return 0;
+}
+
+static void unload_image(RomImage* image) {
+    if (image->data == NULL)
+        return;
+
+#ifdef ROM_IMAGE_MMAP
+    if (image->type != ROM_IMAGE_BUFFER) {
+        munmap((void*)image->data, image->map_size);
+        return;
+    }
+#endif
+
+    free((void*)image->data);
+}
+
+//Fills in which file the ROM is, if the platform can tell
+static void get_file_id(RomImage* image, FILE* rom_file) {
+#ifdef ROM_IMAGE_MMAP
+    struct stat file_info;
+
+    if (fstat(fileno(rom_file), &file_info) != 0)
+        return;
+
+    image->has_file_id = 1;
+    image->file_device = (uint64_t)file_info.st_dev;
+    image->file_inode = (uint64_t)file_info.st_ino;
+    image->file_size = (uint64_t)file_info.st_size;
+    image->file_mtime = (int64_t)file_info.st_mtime;
+#else
+    (void)image;
+    (void)rom_file;
+#endif
+}
+
+//Whether two images are the same ROM. Registry has to be locked
+//Files are compared by identity. Images without one get their contents compared, which means reading them
+static uint8_t same_rom(RomImage* a, RomImage* b) {
+    if (a->size != b->size || a->has_file_id != b->has_file_id)
+        return 0;
+
+    if (a->has_file_id) {
+        return a->file_device == b->file_device && a->file_inode == b->file_inode &&
+            a->file_size == b->file_size && a->file_mtime == b->file_mtime;
+    }
+
+    //(The memcmp is just in case two different ROMs ever have the same hash)
+    return hash_image(a) == hash_image(b) && memcmp(a->data, b->data, a->size) == 0;
+}
+
+//Gets the hash of an image, working it out if no one has asked for it yet
+uint64_t rom_image_hash(RomImage* image) {
+    LOCK_REGISTRY();
+    uint64_t hash = hash_image(image);
+    UNLOCK_REGISTRY();
+
+    return hash;
+}
+
+//64 bit FNV-1a. Registry has to be locked, since the result gets stored in the image
+static uint64_t hash_image(RomImage* image) {
+    if (image->hash_valid)
+        return image->hash;
+
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (size_t i = 0; i < image->size; ++i) {
+        hash ^= image->data[i];
+        hash *= 0x100000001B3;
+    }
+
+    image->hash = hash;
+    image->hash_valid = 1;
+    return hash;
+}
@@ -0,0 +1,160 @@
+#include "rtc.h"
+
+#include <string.h>
+#include <time.h>
+
+#define RTC_CYCLES_PER_DAY ((uint64_t)RTC_SECONDS_PER_DAY * RTC_CYCLES_PER_SECOND)
+
+//Bits each register actually has
+static const uint8_t rtc_register_masks[RTC_REGISTER_COUNT] = { 0x3F, 0x3F, 0x1F, 0xFF, 0xC1 };
+
+//Helper functions
+static uint64_t rtc_now(RTC* rtc);
+static void rtc_update(RTC* rtc);
+static void rtc_get_registers(RTC* rtc, uint8_t* regs);
+static void rtc_set_registers(RTC* rtc, const uint8_t* regs, uint64_t subsecond);
+
+void rtc_init(RTC* rtc) {
+    memset(rtc, 0, sizeof(RTC));
+    rtc->latch_value = 0xFF; //So a 1 on its own doesn't latch
+}
+
+//Switches to a new cycle counter, keeping the current clock value
+void rtc_set_clock(RTC* rtc, const uint64_t* cycle_source) {
+    rtc_update(rtc);
+    rtc->cycle_source = cycle_source;
+    rtc->base_cycle = rtc_now(rtc);
+}
+
+//Writing 0 and then 1 copies the current time into the latched registers
+void rtc_latch_write(RTC* rtc, uint8_t value) {
+    if (rtc->latch_value == 0x00 && value == 0x01) {
+        rtc_update(rtc);
+        rtc_get_registers(rtc, rtc->latched);
+    }
+
+    rtc->latch_value = value;
+}
+
+//Sets one of the clock registers. The rest of the clock keeps its current value
+void rtc_write(RTC* rtc, RTC_Register reg, uint8_t value) {
+    uint8_t index = reg - RTC_SECONDS;
+    if (index >= RTC_REGISTER_COUNT)
+        return;
+
+    rtc_update(rtc);
+
+    uint8_t regs[RTC_REGISTER_COUNT];
+    rtc_get_registers(rtc, regs);
+    uint64_t subsecond = rtc->base_value % RTC_CYCLES_PER_SECOND;
+
+    value &= rtc_register_masks[index];
+    regs[index] = value;
+    rtc->latched[index] = value; //Reads see the new value straight away
+
+    //Writing the seconds resets the part of the second that's gone by
+    if (reg == RTC_SECONDS)
+        subsecond = 0;
+
+    rtc_set_registers(rtc, regs, subsecond);
+}
+
+/*
+* Save data.
+* Same layout as the trailer most other emulators add to MBC3 saves, so saves can go between them:
+* the 5 current registers and then the 5 latched registers as 4 byte little endian values, and then
+* a 64 bit unix timestamp of when the save was written.
+*/
+
+//Returns 0 for success, 1 for failure (older saves might not have a clock at all)
+uint8_t rtc_load(RTC* rtc, FILE* save_file) {
+    uint8_t data[RTC_SAVE_SIZE];
+    if (fread(data, 1, RTC_SAVE_SIZE, save_file) != RTC_SAVE_SIZE)
+        return 1;
+
+    uint8_t regs[RTC_REGISTER_COUNT];
+    for (int i = 0; i < RTC_REGISTER_COUNT; ++i) {
+        regs[i] = data[i * 4] & rtc_register_masks[i];
+        rtc->latched[i] = data[20 + i * 4] & rtc_register_masks[i];
+    }
+
+    uint64_t timestamp = 0;
+    for (int i = 0; i < 8; ++i)
+        timestamp |= (uint64_t)data[40 + i] << (8 * i);
+
+    rtc_update(rtc); //Just moves the base up to now, since whatever was there gets replaced
+    rtc_set_registers(rtc, regs, 0);
+
+    //The clock kept going while the emulator was closed
+    uint64_t now = (uint64_t)time(NULL);
+    if (!rtc->halted && now > timestamp)
+        rtc->base_value += (now - timestamp) * RTC_CYCLES_PER_SECOND;
+
+    rtc_update(rtc); //Handles the day counter overflowing while it was closed
+
+    return 0;
+}
+
+void rtc_save(RTC* rtc, uint8_t* data) {
+    uint8_t regs[RTC_REGISTER_COUNT];
+
+    memset(data, 0, RTC_SAVE_SIZE);
+
+    rtc_update(rtc);
+    rtc_get_registers(rtc, regs);
+
+    for (int i = 0; i < RTC_REGISTER_COUNT; ++i) {
+        data[i * 4] = regs[i];
+        data[20 + i * 4] = rtc->latched[i];
+    }
+
+    uint64_t timestamp = (uint64_t)time(NULL);
+    for (int i = 0; i < 8; ++i)
+        data[40 + i] = (uint8_t)(timestamp >> (8 * i));
+}
+
+//Current emulated time in cycles
+static uint64_t rtc_now(RTC* rtc) {
+    return (rtc->cycle_source != NULL) ? *rtc->cycle_source : 0;
+}
+
+//Works out the current clock value from the cycles since the last update and makes that the new base
+static void rtc_update(RTC* rtc) {
+    uint64_t now = rtc_now(rtc);
+
+    if (!rtc->halted)
+        rtc->base_value += now - rtc->base_cycle;
+
+    rtc->base_cycle = now;
+
+    //Day counter overflowing wraps it around and sets the carry, which stays set until it gets written
+    if (rtc->base_value >= RTC_MAX_DAYS * RTC_CYCLES_PER_DAY) {
+        rtc->base_value %= RTC_MAX_DAYS * RTC_CYCLES_PER_DAY;
+        rtc->day_carry = 1;
+    }
+}
+
+//Splits the clock value into the register values
+static void rtc_get_registers(RTC* rtc, uint8_t* regs) {
+    uint64_t seconds = rtc->base_value / RTC_CYCLES_PER_SECOND;
+    uint16_t days = (uint16_t)(seconds / RTC_SECONDS_PER_DAY);
+
+    regs[0] = seconds % 60;
+    regs[1] = (seconds / 60) % 60;
+    regs[2] = (seconds / 3600) % 24;
+    regs[3] = days & 0xFF;
+    regs[4] = ((days >> 8) & 0x1) | (rtc->halted << 6) | (rtc->day_carry << 7);
+}
+
+//Puts register values back together into the clock value
+//Out of range values (like 60 seconds) just carry into the next register
+static void rtc_set_registers(RTC* rtc, const uint8_t* regs, uint64_t subsecond) {
+    uint64_t days = regs[3] | ((uint64_t)(regs[4] & 0x1) << 8);
+    uint64_t seconds = regs[0] + regs[1] * 60 + regs[2] * 3600 + days * RTC_SECONDS_PER_DAY;
+
+    rtc->base_value = seconds * RTC_CYCLES_PER_SECOND + subsecond;
+    rtc->halted = (regs[4] >> 6) & 0x1;
+    rtc->day_carry = (regs[4] >> 7) & 0x1;
+
+    rtc_update(rtc);
+}
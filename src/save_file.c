@@ -0,0 +1,233 @@
+#include "save_file.h"
+#include "logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/file.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <time.h>
+    #define SAVE_FILE_MMAP
+#endif
+
+#ifdef SAVE_FILE_MMAP
+
+struct SaveFile {
+    int fd;
+    uint8_t* data;
+    size_t size;
+
+    //What goes after EXRAM. Set from the emulator thread, written by whoever flushes next
+    uint8_t trailer[SAVE_TRAILER_MAX];
+    size_t trailer_size;
+    uint8_t trailer_dirty; //Stays set until this exact trailer is on disk
+    uint32_t trailer_version; //Goes up every time it gets set, so a flush can tell if it got replaced while writing
+
+    //Flusher thread (the lock covers the trailer too)
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; //Signalled when the flusher should stop
+    uint32_t interval_ms;
+    uint8_t flusher_running;
+    uint8_t stopping;
+};
+
+static void* flusher_loop(void* arg);
+
+//Maps the first size bytes of the save file, creating it (full of zeroes) if it's not there
+//Anything already in the file past that is left alone
+SaveFile* save_file_open(const char* path, size_t size, uint8_t* in_use) {
+    *in_use = 0;
+
+    if (path == NULL || size == 0)
+        return NULL;
+
+    SaveFile* save = (SaveFile*)calloc(1, sizeof(SaveFile));
+    if (save == NULL)
+        return NULL;
+
+    save->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (save->fd < 0) {
+        free(save);
+        return NULL;
+    }
+
+    //Another emulator writing into the same pages would corrupt both saves
+    if (flock(save->fd, LOCK_EX | LOCK_NB) != 0) {
+        *in_use = (errno == EWOULDBLOCK);
+        close(save->fd);
+        free(save);
+        return NULL;
+    }
+
+    //Files that are too small get padded with zeroes, so the whole mapping is backed by the file
+    struct stat file_info;
+    if (fstat(save->fd, &file_info) != 0 || ((size_t)file_info.st_size < size && ftruncate(save->fd, (off_t)size) != 0)) {
+        close(save->fd);
+        free(save);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, save->fd, 0);
+    if (data == MAP_FAILED) {
+        close(save->fd);
+        free(save);
+        return NULL;
+    }
+
+    save->data = (uint8_t*)data;
+    save->size = size;
+
+    pthread_mutex_init(&save->lock, NULL);
+    pthread_cond_init(&save->wake, NULL);
+
+    return save;
+}
+
+void save_file_close(SaveFile* save) {
+    if (save == NULL)
+        return;
+
+    //Stop the flusher first so it isn't using the mapping
+    if (save->flusher_running) {
+        pthread_mutex_lock(&save->lock);
+        save->stopping = 1;
+        pthread_cond_signal(&save->wake);
+        pthread_mutex_unlock(&save->lock);
+
+        pthread_join(save->flusher, NULL);
+    }
+
+    //Nothing flushes after this, so a trailer that didn't make it is gone
+    save_file_flush(save);
+    if (save->trailer_dirty)
+        log_message(LOG_LEVEL_ERROR, "Save file trailer couldn't be written before closing, RTC state is lost");
+
+    munmap(save->data, save->size);
+    close(save->fd);
+
+    pthread_mutex_destroy(&save->lock);
+    pthread_cond_destroy(&save->wake);
+    free(save);
+}
+
+uint8_t* save_file_data(SaveFile* save) {
+    return save->data;
+}
+
+void save_file_flush(SaveFile* save) {
+    uint8_t trailer[SAVE_TRAILER_MAX];
+    size_t trailer_size = 0;
+    uint32_t trailer_version = 0;
+
+    pthread_mutex_lock(&save->lock);
+    if (save->trailer_dirty) {
+        trailer_size = save->trailer_size;
+        trailer_version = save->trailer_version;
+        memcpy(trailer, save->trailer, trailer_size);
+    }
+    pthread_mutex_unlock(&save->lock);
+
+    msync(save->data, save->size, MS_SYNC);
+
+    if (trailer_size == 0)
+        return;
+
+    //Trailer stays dirty if this fails, so the next flush (or closing) tries again
+    ssize_t written = pwrite(save->fd, trailer, trailer_size, (off_t)save->size);
+    if (written != (ssize_t)trailer_size) {
+        if (written < 0)
+            log_message(LOG_LEVEL_ERROR, "Unable to write save file trailer, trying again on the next flush");
+        else
+            log_message(LOG_LEVEL_ERROR, "Save file trailer was only partly written, trying again on the next flush");
+        return;
+    }
+
+    if (fdatasync(save->fd) != 0) {
+        log_message(LOG_LEVEL_ERROR, "Unable to sync save file trailer, trying again on the next flush");
+        return;
+    }
+
+    //Only done if nothing newer got set in the meantime
+    pthread_mutex_lock(&save->lock);
+    if (save->trailer_version == trailer_version)
+        save->trailer_dirty = 0;
+    pthread_mutex_unlock(&save->lock);
+}
+
+void save_file_set_trailer(SaveFile* save, const uint8_t* data, size_t size) {
+    if (size > SAVE_TRAILER_MAX)
+        return;
+
+    pthread_mutex_lock(&save->lock);
+    memcpy(save->trailer, data, size);
+    save->trailer_size = size;
+    save->trailer_dirty = 1;
+    ++save->trailer_version;
+    pthread_mutex_unlock(&save->lock);
+}
+
+//Starts flushing every interval_ms on another thread. 0 leaves it to the OS (and closing)
+uint8_t save_file_start_flusher(SaveFile* save, uint32_t interval_ms) {
+    if (save == NULL || interval_ms == 0 || save->flusher_running)
+        return 1;
+
+    save->interval_ms = interval_ms;
+
+    if (pthread_create(&save->flusher, NULL, flusher_loop, save) != 0) {
+        log_message(LOG_LEVEL_ERROR, "Unable to start save flusher");
+        return 1;
+    }
+
+    save->flusher_running = 1;
+    return 0;
+}
+
+//Sleeps for the interval, then pushes whatever pages are dirty out to disk
+static void* flusher_loop(void* arg) {
+    SaveFile* save = (SaveFile*)arg;
+
+    pthread_mutex_lock(&save->lock);
+
+    while (!save->stopping) {
+        struct timespec wake_time;
+        clock_gettime(CLOCK_REALTIME, &wake_time);
+        wake_time.tv_sec += save->interval_ms / 1000;
+        wake_time.tv_nsec += (long)(save->interval_ms % 1000) * 1000000;
+        if (wake_time.tv_nsec >= 1000000000) {
+            wake_time.tv_nsec -= 1000000000;
+            ++wake_time.tv_sec;
+        }
+
+        pthread_cond_timedwait(&save->wake, &save->lock, &wake_time);
+
+        if (save->stopping)
+            break;
+
+        //Don't hold the lock while it's writing, or closing would have to wait on the disk
+        pthread_mutex_unlock(&save->lock);
+        save_file_flush(save);
+        pthread_mutex_lock(&save->lock);
+    }
+
+    pthread_mutex_unlock(&save->lock);
+    return NULL;
+}
+
+#else
+
+//No mmap, so EXRAM just gets saved when the emulator closes like before
+SaveFile* save_file_open(const char* path, size_t size, uint8_t* in_use) { *in_use = 0; return NULL; }
+void save_file_close(SaveFile* save) {}
+uint8_t* save_file_data(SaveFile* save) { return NULL; }
+void save_file_flush(SaveFile* save) {}
+void save_file_set_trailer(SaveFile* save, const uint8_t* data, size_t size) {}
+uint8_t save_file_start_flusher(SaveFile* save, uint32_t interval_ms) { return 1; }
+
+#endif
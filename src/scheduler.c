@@ -0,0 +1,112 @@
+#include "scheduler.h"
+
+//Helper functions
+static uint8_t comes_before(Scheduler* scheduler, uint8_t a, uint8_t b);
+static void swap_entries(Scheduler* scheduler, uint8_t i, uint8_t j);
+static void sift_up(Scheduler* scheduler, uint8_t i);
+static void sift_down(Scheduler* scheduler, uint8_t i);
+static void remove_entry(Scheduler* scheduler, uint8_t i);
+
+void scheduler_init(Scheduler* scheduler) {
+    scheduler->count = 0;
+
+    for (int i = 0; i < EVENT_COUNT; ++i)
+        scheduler->times[i] = SCHEDULER_NEVER;
+}
+
+void scheduler_post(Scheduler* scheduler, EventType event, uint64_t time) {
+    uint8_t pending = scheduler->times[event] != SCHEDULER_NEVER;
+    uint64_t old_time = scheduler->times[event];
+
+    scheduler->times[event] = time;
+
+    if (!pending) {
+        uint8_t i = scheduler->count++;
+        scheduler->heap[i] = (uint8_t)event;
+        scheduler->heap_index[event] = i;
+        sift_up(scheduler, i);
+    }
+    else if (time < old_time)
+        sift_up(scheduler, scheduler->heap_index[event]);
+    else
+        sift_down(scheduler, scheduler->heap_index[event]);
+}
+
+void scheduler_cancel(Scheduler* scheduler, EventType event) {
+    if (scheduler->times[event] == SCHEDULER_NEVER)
+        return;
+
+    remove_entry(scheduler, scheduler->heap_index[event]);
+}
+
+EventType scheduler_pop(Scheduler* scheduler) {
+    EventType event = (EventType)scheduler->heap[0];
+    remove_entry(scheduler, 0);
+
+    return event;
+}
+
+//Earlier time first, and the order in EventType breaks ties
+static uint8_t comes_before(Scheduler* scheduler, uint8_t a, uint8_t b) {
+    if (scheduler->times[a] != scheduler->times[b])
+        return scheduler->times[a] < scheduler->times[b];
+
+    return a < b;
+}
+
+static void swap_entries(Scheduler* scheduler, uint8_t i, uint8_t j) {
+    uint8_t event_i = scheduler->heap[i];
+    uint8_t event_j = scheduler->heap[j];
+
+    scheduler->heap[i] = event_j;
+    scheduler->heap[j] = event_i;
+    scheduler->heap_index[event_j] = i;
+    scheduler->heap_index[event_i] = j;
+}
+
+static void sift_up(Scheduler* scheduler, uint8_t i) {
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!comes_before(scheduler, scheduler->heap[i], scheduler->heap[parent]))
+            break;
+
+        swap_entries(scheduler, i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(Scheduler* scheduler, uint8_t i) {
+    for (;;) {
+        uint8_t smallest = i;
+        uint8_t left = 2 * i + 1;
+        uint8_t right = 2 * i + 2;
+
+        if (left < scheduler->count && comes_before(scheduler, scheduler->heap[left], scheduler->heap[smallest]))
+            smallest = left;
+        if (right < scheduler->count && comes_before(scheduler, scheduler->heap[right], scheduler->heap[smallest]))
+            smallest = right;
+
+        if (smallest == i)
+            break;
+
+        swap_entries(scheduler, i, smallest);
+        i = smallest;
+    }
+}
+
+//Takes an entry out of the heap and marks its event as not pending
+static void remove_entry(Scheduler* scheduler, uint8_t i) {
+    uint8_t event = scheduler->heap[i];
+    uint8_t last = --scheduler->count;
+
+    if (i != last) {
+        swap_entries(scheduler, i, last);
+
+        //Whatever got moved in could belong either higher or lower
+        uint8_t moved = scheduler->heap[i];
+        sift_up(scheduler, i);
+        sift_down(scheduler, scheduler->heap_index[moved]);
+    }
+
+    scheduler->times[event] = SCHEDULER_NEVER;
+}
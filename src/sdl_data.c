@@ -16,7 +16,7 @@ SDL_Data* sdl_init(int screen_width, int screen_height) {
 
     //Video
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printError("Failed to initialize SDL Video");
+        log_message(LOG_LEVEL_ERROR, "Failed to initialize SDL Video");
         sdl_destroy(data);
         return NULL;
     }
@@ -27,7 +27,7 @@ SDL_Data* sdl_init(int screen_width, int screen_height) {
 
     //Audio
     if (SDL_Init(SDL_INIT_AUDIO) != 0) {
-        printError("Failed to initialize SDL Audio");
+        log_message(LOG_LEVEL_ERROR, "Failed to initialize SDL Audio");
         sdl_destroy(data);
         return NULL;
     }
@@ -45,7 +45,7 @@ SDL_Data* sdl_init(int screen_width, int screen_height) {
     SDL_ClearQueuedAudio(dev);
 
 	if (data == NULL || display_data == NULL || input_data == NULL || audio_data == NULL || !window || !renderer || !texture) {
-		printError("Error creating window");
+		log_message(LOG_LEVEL_ERROR, "Error creating window");
 		sdl_destroy(data);
 		return NULL;
 	}
@@ -1,42 +1,74 @@
 #include <stdlib.h>
+#include <string.h>
 #include "system.h" 
 #include "system_state.h"
+#include "core_state.h"
 #include "logging.h"
+#include "jit.h"
+#include "recomp.h"
+#include "dma.h"
 
 EmulatorSystem* system_init(FILE* rom_file, FILE* boot_rom_file, SDL_Data* sdl_data) {
     //ROM and SDL information required for emulator to run
     if (rom_file == NULL || sdl_data == NULL) {
-        printError("Unable to open ROM");
+        log_message(LOG_LEVEL_ERROR, "Unable to open ROM");
         return NULL;
     }
 
-    EmulatorSystem* system = malloc(sizeof(EmulatorSystem));
+    EmulatorSystem* system = calloc(1, sizeof(EmulatorSystem));
     if (system == NULL) {
-        printError("Unable to open ROM");
+        log_message(LOG_LEVEL_ERROR, "Unable to open ROM");
         return NULL;
     }
 
     //SDL Data
     system->sdl_data = sdl_data;
 
-    //Memory and System State
-    system->memory = memory_init(rom_file, boot_rom_file);
-    system->system_state = system_state_init();
-    system->bus = memory_bus_init(system->memory, system->system_state);
-    
-    //Subsystems
-    system->cpu = cpu_init(system->bus);
-    system->ppu = ppu_init(system->bus, system->system_state->ppu_state, sdl_data->display_data);
-    system->sys_clock = master_clock_init(system->system_state->timer_state);
-    system->apu = apu_init(system->bus, system->system_state->apu_state, sdl_data->audio_data);
+    //Memory. The rest of the machine goes in its arena too, so that needs room for it
+    size_t system_size = CORE_STATE_ARENA_SPACE;
+#ifdef BLOCK_CACHE
+    system_size += BLOCK_CACHE_ARENA_SPACE;
+#endif
+    system->memory = memory_init(rom_file, boot_rom_file, system_size);
+
+    //System state and subsystems all live together in the core state
+    system->core = (system->memory != NULL) ? core_state_init(system->memory, sdl_data) : NULL;
+
+    if (system->core != NULL) {
+        system->system_state = &system->core->system_state;
+        system->bus = &system->core->bus;
+        system->cpu = &system->core->cpu;
+        system->ppu = &system->core->ppu;
+        system->apu = &system->core->apu;
+        system->sys_clock = &system->core->sys_clock;
+    }
+
+    system->block_cache = NULL;
+    system->jit = NULL;
+    system->frame_limit = 0;
+    system->frames_run = 0;
+
+#ifdef BLOCK_CACHE
+    //Block cache is optional, so if it fails the emulator just runs without it
+    system->block_cache = block_cache_init(system->memory);
+    if (system->core != NULL)
+        system->bus->block_cache = system->block_cache;
+
+    //Use the recompiled blocks if they were made from this ROM
+    if (system->block_cache != NULL && system->memory != NULL)
+        system->block_cache->use_recompiled = recomp_matches_rom(system->memory);
+#endif
 
     //If required systems are NULL, destroy system and return NULL
-    if (system->memory == NULL || system->system_state == NULL || system->bus == NULL ||
-        system->cpu == NULL || system->ppu == NULL || system->sys_clock == NULL || system->apu == NULL) {
+    if (system->memory == NULL || system->core == NULL) {
         system_destroy(system);
         return NULL;
     }
 
+    //RTC measures time in emulated cycles, so it needs to know where to find them
+    if (system->memory->mbc_chip->has_rtc)
+        rtc_set_clock(&system->memory->mbc_chip->rtc, &system->core->timer_state.elapsed_time);
+
     return system;
 }
 
@@ -44,89 +76,148 @@ void system_destroy(EmulatorSystem* system) {
     if (system == NULL)
         return;
     
-    //Destroys each the pointers it owns
-    if (system->bus != NULL) { memory_bus_destroy(system->bus); }
+    //Destroys each the pointers it owns. Core state and the block cache are in the memory arena
+    if (system->jit != NULL) { jit_destroy(system->jit); }
     if (system->memory != NULL) { memory_destroy(system->memory); }
-    if (system->system_state != NULL) { system_state_destroy(system->system_state); }
-    if (system->cpu != NULL) { cpu_destroy(system->cpu); }
-    if (system->ppu != NULL) { ppu_destroy(system->ppu); }
-    if (system->apu != NULL) { apu_destroy(system->apu); }
-    if (system->sys_clock != NULL) { master_clock_destroy(system->sys_clock); }
 
     free(system); //Free itself
 }
 
+//Battery EXRAM mapped from the save file is the only machine state outside the arena
+static size_t mapped_exram_size(Memory* mem) {
+    return (mem->save_file != NULL) ? mem->mbc_chip->exram_size : 0;
+}
+
+size_t system_snapshot_size(EmulatorSystem* system) {
+    return system->memory->arena.used + mapped_exram_size(system->memory);
+}
+
+//The used part of the arena, then mapped EXRAM if there is any
+void system_save_snapshot(EmulatorSystem* system, uint8_t* data) {
+    Memory* mem = system->memory;
+    size_t arena_size = mem->arena.used;
+
+    memcpy(data, mem->arena.base, arena_size);
+    memcpy(data + arena_size, mem->exram_x, mapped_exram_size(mem));
+}
+
+//Nothing gets allocated from the arena after init, so the copy lines up with it exactly.
+//Block cache comes back with it, but JIT translations it points at might be gone by now, so those get thrown out
+void system_load_snapshot(EmulatorSystem* system, const uint8_t* data) {
+    Memory* mem = system->memory;
+    uint8_t* base = mem->arena.base; //Memory struct is in there, so this has to be read before the copy
+    size_t arena_size = mem->arena.used;
+
+    memcpy(base, data, arena_size);
+    memcpy(mem->exram_x, data + arena_size, mapped_exram_size(mem));
+
+    if (system->jit != NULL)
+        jit_flush(system->jit);
+}
+
+//Event handlers, in EventType order
+static void timer_event_handler(EmulatorSystem* system, uint64_t time);
+static void dma_event_handler(EmulatorSystem* system, uint64_t time);
+static void apu_div_event_handler(EmulatorSystem* system, uint64_t time);
+static void frame_end_event_handler(EmulatorSystem* system, uint64_t time);
+static void ppu_event_handler(EmulatorSystem* system, uint64_t time);
+static void apu_sample_event_handler(EmulatorSystem* system, uint64_t time);
+
+typedef void (*EventHandler)(EmulatorSystem* system, uint64_t time);
+
+static const EventHandler event_handlers[EVENT_COUNT] = {
+    [EVENT_TIMER] = timer_event_handler,
+    [EVENT_DMA] = dma_event_handler,
+    [EVENT_APU_FRAME_SEQUENCER] = apu_div_event_handler,
+    [EVENT_FRAME_END] = frame_end_event_handler,
+    [EVENT_PPU] = ppu_event_handler,
+    [EVENT_APU_SAMPLE] = apu_sample_event_handler
+};
+
 //Updates timing of different hardware
+//The timer, PPU and APU all work from elapsed time, so the only ticks that need anything are the ones with events on them.
+//Time goes straight from one of those to the next. The timing state is read straight out of the core state
 void tick_hardware(EmulatorSystem* system, uint16_t ticks) {
-    uint16_t elapsed_ticks = 0;
-
-    while (elapsed_ticks < ticks) {
-        update_timing_registers(system->sys_clock, system->memory); //Update timer registers
-        update_dma_transfer(system); //Handle DMA transfer if active
-        update_ppu(system->ppu);
-        update_apu(system->apu, system->sys_clock->global_state->elapsed_time);
-
-        //If frame just ends, poll SDL to update input/fast forward toggle and check if the emulator is closed
-        if (system->system_state->ppu_state->frame_time == 0) {
-            if (poll_events(system->sdl_data->input_data)) {
-                system->system_state->running = 0; //If SDL is quit, stop running emulator
-            }
-            
-            //Update memory state to reflect current button state
-            system->memory->local_state.button_state = system->sdl_data->input_data->button_state;
-            system->memory->local_state.dpad_state = system->sdl_data->input_data->dpad_state;
-
-            //If fast foward is on, quaduple framerate
-           if (system->sdl_data->input_data->fast_foward)
-                system->system_state->ppu_state->frame_rate = 59.73 * 4;
-            else
-                system->system_state->ppu_state->frame_rate = 59.73;
-        }
-
-        //Add to system time and frame time and update elapsed_ticks
-        ++system->sys_clock->global_state->system_time;
-        ++system->system_state->ppu_state->frame_time;
-        ++system->sys_clock->global_state->elapsed_time;
-
-        ++elapsed_ticks;
+    CoreState* core = system->core;
+    uint64_t target = core->timer_state.elapsed_time + ticks;
+
+    while (core->timer_state.elapsed_time < target) {
+        //Anything scheduled for this tick happens before the CPU gets to see it
+        if (core->timer_state.elapsed_time >= scheduler_next_time(&core->scheduler))
+            run_events(system);
+
+        uint64_t next_event = scheduler_next_time(&core->scheduler);
+        core->timer_state.elapsed_time = (next_event < target) ? next_event : target;
     }
 }
 
-//Updates DMA
-void update_dma_transfer(EmulatorSystem* system) {
-    //Wasn't really sure where to put this since DMA is just a memory transfer
-    //It didn't feel like it belongs in memory, and it doesn't feel like DMA needs its own module, 
-    //so I'm just going to keep it here for now since it is technically a coordinate of different subsystems
-    if (!system->system_state->dma_state->active)
-        return;
+//Runs every event that's due by the current tick. Handlers can post more events, including for this tick
+void run_events(EmulatorSystem* system) {
+    Scheduler* scheduler = &system->core->scheduler;
+    uint64_t now = system->core->timer_state.elapsed_time;
 
-    //Decrement remaining cycles, this allows for 160 to not be included and 0 to be included, which is accurate start/end timing
-    --system->system_state->dma_state->remaining_cycles;
+    while (scheduler_next_time(scheduler) <= now) {
+        uint64_t time = scheduler_next_time(scheduler);
+        EventType event = scheduler_pop(scheduler);
 
-    //DMA transfer transfers from 0xXX00-0xXX9F to 0xFE00 to 0xFE9F
-    uint16_t remaining_cycles = system->system_state->dma_state->remaining_cycles;
-    
-    //1 transfer is completed every 4 ticks (each m cycle)
-    //Only do the write if we are below the "start" point
-    if (remaining_cycles % 4 == 0) {
-        //DMA works like echo RAM
-        //So I am simulating this by just putting the offset into 0xDE range instead
-        if (system->system_state->dma_state->source >= 0xFE) {
-            system->system_state->dma_state->source -= 0xFE;
-            system->system_state->dma_state->source += 0xDE;
-        }
-
-        uint16_t src_address = 
-            ((uint16_t)(system->system_state->dma_state->source << 8) | 0x00) + ((640 - remaining_cycles) / 4) - 1; //Divide by 4 since each write happens every 4 ticks
-        uint16_t dest_address = 0xFE00 + (640 - remaining_cycles) / 4 - 1;
-
-        uint8_t val = mem_read(system->bus, src_address, DMA_ACCESS);
-        mem_write(system->bus, dest_address, val, DMA_ACCESS);
+        event_handlers[event](system, time);
     }
+}
+
+//TIMA reload after an overflow. The rest of the timer only gets updated when it's accessed (see master_clock.h)
+static void timer_event_handler(EmulatorSystem* system, uint64_t time) {
+    timer_event(&system->core->timer_state, system->memory, &system->core->scheduler, time);
+}
+
+//Next OAM DMA byte or the end of the transfer. The transfer itself is in dma.c
+static void dma_event_handler(EmulatorSystem* system, uint64_t time) {
+    dma_event(system->bus, time);
+}
+
+static void apu_div_event_handler(EmulatorSystem* system, uint64_t time) {
+    apu_div_event(system->apu, time);
+}
+
+//When a frame ends, draw it and poll SDL to update input/fast forward toggle and check if the emulator is closed
+static void frame_end_event_handler(EmulatorSystem* system, uint64_t time) {
+    //PPU does this tick after the frame end, so the frame gets finished up to right before it
+    ppu_catch_up(system->ppu, time);
+
+    //Draws buffer through SDL and waits to maintain framerate
+    //Nothing gets drawn during VBlank, so the frame is already done. The first poll at startup doesn't have a frame yet
+    if (system->core->ppu_state.frame_time == MODE_1_END)
+        draw_buffer(system->sdl_data->display_data, system->ppu->framebuffer, system->core->ppu_state.frame_rate);
 
-    //If remaining cycles is 0 (DMA transfer just finished), reset it
-    if (system->system_state->dma_state->remaining_cycles == 0) {
-        system->system_state->dma_state->remaining_cycles = 640;
-        system->system_state->dma_state->active = 0;
+    if (poll_events(system->sdl_data->input_data)) {
+        system->system_state->running = 0; //If SDL is quit, stop running emulator
     }
-}
\ No newline at end of file
+
+    //Stop once the frame limit is hit
+    if (system->frame_limit != 0 && ++system->frames_run >= system->frame_limit)
+        system->system_state->running = 0;
+    
+    //Clock in the save keeps up with the game, in case it never gets to close properly
+    save_update_trailer(system->memory);
+
+    //Update memory state to reflect current button state
+    system->memory->local_state.button_state = system->sdl_data->input_data->button_state;
+    system->memory->local_state.dpad_state = system->sdl_data->input_data->dpad_state;
+
+    //If fast foward is on, quaduple framerate
+    if (system->sdl_data->input_data->fast_foward)
+        system->system_state->ppu_state->frame_rate = 59.73 * 4;
+    else
+        system->system_state->ppu_state->frame_rate = 59.73;
+
+    ppu_post_frame_end(&system->core->scheduler, &system->core->ppu_state, time);
+}
+
+//PPU could request an interrupt on this tick. Everything else it does waits until something looks at it
+static void ppu_event_handler(EmulatorSystem* system, uint64_t time) {
+    ppu_event(system->ppu, time);
+}
+
+//Next audio sample. The APU does everything before it first
+static void apu_sample_event_handler(EmulatorSystem* system, uint64_t time) {
+    apu_sample_event(system->apu, time);
+}
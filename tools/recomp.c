@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "opcode_table.h"
+
+/*
+* ROM to C recompiler.
+* Finds every block it can reach from the entry point (0x100), the RST vectors and the interrupt vectors
+* (0x40-0x60, what serviceInterrupt jumps to), and writes a C file with one function per block. Each function
+* calls the same specialized handlers the interpreter uses, in order, with the same ticks in between,
+* so compiling it into the emulator (RECOMP_SOURCE in CMakeLists.txt) doesn't change any timing.
+*
+* Blocks are split the same way the block cache splits them (see block_cache.c), since recompiled blocks
+* get looked up when the block cache decodes a block.
+*
+* What gets left to the interpreter:
+* - JP HL, since the target isn't known until it runs
+* - Anything in RAM
+* - Jumps from bank 0 into 0x4000-0x7FFF when the bank can't be worked out. The bank is only known if the
+*   same block wrote a constant to the MBC bank register (ld a, n / ld [$2xxx], a), which covers the usual
+*   "switch bank and call" pattern. A wrong guess just means a block that never gets used, since blocks are
+*   looked up by the bank that's actually mapped.
+*
+* Usage: clair-recomp rom.gb out.c
+*/
+
+#define MAX_BLOCK_INSTRUCTIONS 16 //Same as BLOCK_MAX_INSTRUCTIONS in block_cache.h
+
+//What the tool needs to know about each opcode, pulled from opcode_table.h
+typedef struct {
+    uint8_t valid;
+    uint8_t size;
+    uint8_t cycles;
+} OpInfo;
+
+#define MAIN_INFO(opcode, function, first_op, second_op, size, cycles) [opcode] = {1, size, cycles},
+#define CB_INFO(opcode, function, first_op, second_op, size, cycles) [opcode] = {1, size, cycles},
+
+static const OpInfo main_info[256] = { MAIN_OPCODE_TABLE(MAIN_INFO) };
+static const OpInfo cb_info[256] = { CB_OPCODE_TABLE(CB_INFO) };
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t cb_prefix;
+    uint8_t cycles;
+} RecompInstruction;
+
+typedef struct {
+    uint16_t bank;
+    uint16_t pc;
+    uint8_t num_instructions;
+    RecompInstruction instructions[MAX_BLOCK_INSTRUCTIONS];
+} RecompBlock;
+
+typedef struct {
+    uint16_t bank;
+    uint16_t pc;
+} BlockAddress;
+
+//Everything about the ROM being recompiled
+typedef struct {
+    uint8_t* rom;
+    uint32_t rom_size;
+    uint16_t num_banks;
+    uint8_t is_mbc5; //MBC5 is the only one where writing 0 selects bank 0
+
+    //Blocks that have been found, so they aren't decoded twice
+    uint8_t* visited_bank_0; //pc < 0x4000
+    uint8_t* visited_banked; //bank * 0x4000 + (pc - 0x4000)
+
+    BlockAddress* worklist;
+    uint32_t worklist_size;
+    uint32_t worklist_capacity;
+
+    RecompBlock* blocks;
+    uint32_t num_blocks;
+    uint32_t blocks_capacity;
+
+    //Stats
+    uint32_t skipped_indirect;
+    uint32_t skipped_ram;
+    uint32_t skipped_unknown_bank;
+} Recompiler;
+
+//Same hash as rom_image_hash in src/rom_image.c
+static uint64_t rom_hash(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3;
+    }
+
+    return hash;
+}
+
+static uint8_t read_rom(Recompiler* r, uint16_t bank, uint16_t address) {
+    if (address < 0x4000)
+        return r->rom[address];
+
+    return r->rom[(uint32_t)bank * 0x4000 + (address - 0x4000)];
+}
+
+static void push_block(Recompiler* r, uint16_t bank, uint16_t pc) {
+    uint8_t* visited = (pc < 0x4000) ? &r->visited_bank_0[pc] : &r->visited_banked[(uint32_t)bank * 0x4000 + (pc - 0x4000)];
+
+    if (*visited)
+        return;
+    *visited = 1;
+
+    if (r->worklist_size == r->worklist_capacity) {
+        r->worklist_capacity = r->worklist_capacity ? r->worklist_capacity * 2 : 256;
+        r->worklist = (BlockAddress*)realloc(r->worklist, r->worklist_capacity * sizeof(BlockAddress));
+        if (r->worklist == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    r->worklist[r->worklist_size++] = (BlockAddress){bank, pc};
+}
+
+//Queues a jump/call target. bank is the bank the jump is in, bank_hint is a bank the block switched to (or -1)
+static void add_target(Recompiler* r, uint16_t bank, uint16_t from_pc, uint16_t target, int bank_hint) {
+    if (target < 0x4000)
+        push_block(r, 0, target);
+
+    //Jumps inside a switchable bank stay in that bank
+    else if (target < 0x8000 && from_pc >= 0x4000)
+        push_block(r, bank, target);
+
+    else if (target < 0x8000 && bank_hint >= 0)
+        push_block(r, (uint16_t)bank_hint, target);
+
+    else if (target < 0x8000)
+        ++r->skipped_unknown_bank;
+
+    else
+        ++r->skipped_ram;
+}
+
+//Works out which bank writing val to the bank register selects
+static int bank_from_write(Recompiler* r, uint8_t val) {
+    int bank = val & (r->num_banks - 1);
+
+    if (bank == 0 && !r->is_mbc5)
+        bank = 1;
+
+    return bank;
+}
+
+//Decodes one block and queues everything it can go to next
+static void decode_block(Recompiler* r, uint16_t bank, uint16_t pc) {
+    RecompBlock block = {.bank = bank, .pc = pc, .num_instructions = 0};
+    uint32_t address = pc;
+    uint32_t area_end = (pc < 0x4000) ? 0x4000 : 0x8000;
+
+    //Tracks ld a, n so bank switches can be followed
+    int a_value = -1;
+    int bank_hint = -1;
+    uint8_t ended = 0;
+
+    while (block.num_instructions < MAX_BLOCK_INSTRUCTIONS && address < area_end) {
+        uint8_t opcode = read_rom(r, bank, (uint16_t)address);
+        uint8_t cb_prefix = (opcode == 0xCB);
+        const OpInfo* info;
+
+        if (cb_prefix) {
+            if (address + 1 >= area_end)
+                break;
+
+            opcode = read_rom(r, bank, (uint16_t)(address + 1));
+            info = &cb_info[opcode];
+        }
+        else
+            info = &main_info[opcode];
+
+        //Illegal opcode, or an instruction that hangs off the end of the area
+        if (!info->valid || address + info->size > area_end)
+            break;
+
+        block.instructions[block.num_instructions++] = (RecompInstruction){opcode, cb_prefix, info->cycles};
+
+        uint16_t next = (uint16_t)(address + info->size);
+        uint8_t imm8 = (info->size > 1) ? read_rom(r, bank, (uint16_t)(address + 1)) : 0;
+        uint16_t imm16 = (info->size > 2) ? (uint16_t)(imm8 | (read_rom(r, bank, (uint16_t)(address + 2)) << 8)) : 0;
+
+        address = next;
+
+        if (cb_prefix) {
+            a_value = -1;
+            continue;
+        }
+
+        switch (opcode) {
+            //ld a, n
+            case 0x3E:
+                a_value = imm8;
+                break;
+
+            //ld [a16], a. Writes to 0x2000-0x3FFF select the ROM bank on every MBC
+            case 0xEA:
+                if (imm16 >= 0x2000 && imm16 < 0x4000 && a_value >= 0)
+                    bank_hint = bank_from_write(r, (uint8_t)a_value);
+                break;
+
+            //jr e
+            case 0x18:
+                add_target(r, bank, pc, (uint16_t)(next + (int8_t)imm8), bank_hint);
+                ended = 1;
+                break;
+
+            //jr cc, e
+            case 0x20: case 0x28: case 0x30: case 0x38:
+                add_target(r, bank, pc, (uint16_t)(next + (int8_t)imm8), bank_hint);
+                push_block(r, bank, next);
+                ended = 1;
+                break;
+
+            //jp a16
+            case 0xC3:
+                add_target(r, bank, pc, imm16, bank_hint);
+                ended = 1;
+                break;
+
+            //jp cc, a16 and call (cc,) a16. Calls come back, so the next instruction is a block too
+            case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+            case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+                add_target(r, bank, pc, imm16, bank_hint);
+                push_block(r, bank, next);
+                ended = 1;
+                break;
+
+            //jp hl
+            case 0xE9:
+                ++r->skipped_indirect;
+                ended = 1;
+                break;
+
+            //ret/reti. Where it goes is wherever the call came from, which is already queued
+            case 0xC9: case 0xD9:
+                ended = 1;
+                break;
+
+            //ret cc, rst, halt, stop all carry on to the next instruction eventually
+            case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+            case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+            case 0x76: case 0x10:
+                if (next < area_end)
+                    push_block(r, bank, next);
+                ended = 1;
+                break;
+
+            //Everything else could change A, except the writes above
+            default:
+                a_value = -1;
+                break;
+        }
+
+        if (ended)
+            break;
+    }
+
+    if (block.num_instructions == 0)
+        return;
+
+    //Block got split for being too long, so the rest is its own block
+    if (!ended && block.num_instructions == MAX_BLOCK_INSTRUCTIONS && address < area_end)
+        push_block(r, bank, (uint16_t)address);
+
+    if (r->num_blocks == r->blocks_capacity) {
+        r->blocks_capacity = r->blocks_capacity ? r->blocks_capacity * 2 : 256;
+        r->blocks = (RecompBlock*)realloc(r->blocks, r->blocks_capacity * sizeof(RecompBlock));
+        if (r->blocks == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    r->blocks[r->num_blocks++] = block;
+}
+
+static int compare_blocks(const void* a, const void* b) {
+    const RecompBlock* block_a = (const RecompBlock*)a;
+    const RecompBlock* block_b = (const RecompBlock*)b;
+    uint32_t key_a = ((uint32_t)block_a->bank << 16) | block_a->pc;
+    uint32_t key_b = ((uint32_t)block_b->bank << 16) | block_b->pc;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static void write_output(Recompiler* r, FILE* out, const char* rom_name) {
+    fprintf(out, "//Generated by clair-recomp from %s. Don't edit, regenerate it instead\n", rom_name);
+    fprintf(out, "#include \"recomp.h\"\n\n");
+
+    for (uint32_t i = 0; i < r->num_blocks; ++i) {
+        RecompBlock* block = &r->blocks[i];
+
+        fprintf(out, "RECOMP_BLOCK(0x%03X, 0x%04X) {\n", block->bank, block->pc);
+        fprintf(out, "    RECOMP_BLOCK_START\n");
+
+        for (int j = 0; j < block->num_instructions; ++j) {
+            RecompInstruction* instr = &block->instructions[j];
+
+            fprintf(out, "    RECOMP_OP(%d, %d, %s_op_0x%02X)", instr->cb_prefix ? 2 : 1, instr->cycles,
+                instr->cb_prefix ? "cb" : "main", instr->opcode);
+            fprintf(out, (j != block->num_instructions - 1) ? " RECOMP_CHECK\n" : "\n");
+        }
+
+        fprintf(out, "}\n\n");
+    }
+
+    fprintf(out, "const RecompBlock recomp_blocks[] = {\n");
+    for (uint32_t i = 0; i < r->num_blocks; ++i) {
+        fprintf(out, "    {0x%03X, 0x%04X, RECOMP_BLOCK_NAME(0x%03X, 0x%04X)},\n",
+            r->blocks[i].bank, r->blocks[i].pc, r->blocks[i].bank, r->blocks[i].pc);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "const uint32_t recomp_num_blocks = %u;\n", r->num_blocks);
+    fprintf(out, "const uint64_t recomp_rom_checksum = 0x%016llXULL;\n", (unsigned long long)rom_hash(r->rom, r->rom_size));
+}
+
+//Loads ROM the same way memory_init does, so the checksum lines up
+static uint8_t load_rom(Recompiler* r, const char* path) {
+    FILE* rom_file = fopen(path, "rb");
+    if (rom_file == NULL) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return 1;
+    }
+
+    uint8_t header[0x150];
+    if (fread(header, 1, sizeof(header), rom_file) != sizeof(header)) {
+        fprintf(stderr, "ROM file too small!\n");
+        fclose(rom_file);
+        return 1;
+    }
+
+    r->num_banks = (uint16_t)(2 << header[0x148]);
+    r->is_mbc5 = (header[0x147] >= 0x19 && header[0x147] <= 0x1E);
+    r->rom_size = (uint32_t)r->num_banks * 0x4000;
+    r->rom = (uint8_t*)calloc(r->rom_size, 1);
+    r->visited_bank_0 = (uint8_t*)calloc(0x4000, 1);
+    r->visited_banked = (uint8_t*)calloc(r->rom_size, 1);
+
+    if (r->rom == NULL || r->visited_bank_0 == NULL || r->visited_banked == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        fclose(rom_file);
+        return 1;
+    }
+
+    rewind(rom_file);
+    size_t num_read = fread(r->rom, 1, r->rom_size, rom_file);
+    fclose(rom_file);
+
+    if (num_read == 0) {
+        fprintf(stderr, "ROM file too small!\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        printf("Usage: clair-recomp rom.gb out.c\n");
+        return 1;
+    }
+
+    Recompiler r;
+    memset(&r, 0, sizeof(r));
+
+    if (load_rom(&r, argv[1]) == 1)
+        return 1;
+
+    //Entry point, RST vectors and interrupt vectors
+    push_block(&r, 0, 0x100);
+    for (uint16_t vector = 0x00; vector <= 0x38; vector += 0x08)
+        push_block(&r, 0, vector);
+    for (uint16_t vector = 0x40; vector <= 0x60; vector += 0x08)
+        push_block(&r, 0, vector);
+
+    while (r.worklist_size != 0) {
+        BlockAddress next = r.worklist[--r.worklist_size];
+        decode_block(&r, next.bank, next.pc);
+    }
+
+    qsort(r.blocks, r.num_blocks, sizeof(RecompBlock), compare_blocks);
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Unable to open %s\n", argv[2]);
+        return 1;
+    }
+
+    write_output(&r, out, argv[1]);
+    fclose(out);
+
+    printf("%u blocks recompiled. Left to the interpreter: %u JP HL, %u jumps into RAM, %u jumps into an unknown bank\n",
+        r.num_blocks, r.skipped_indirect, r.skipped_ram, r.skipped_unknown_bank);
+
+    free(r.rom);
+    free(r.visited_bank_0);
+    free(r.visited_banked);
+    free(r.worklist);
+    free(r.blocks);
+
+    return 0;
+}